@@ -0,0 +1,285 @@
+//-------------------------------------------------
+//
+//          Laminar cortex model
+//
+// Developed by Jiaxin Du under the supervision of
+//    Prof. David Reutens and Dr. Viktor Vegh
+//
+//       Centre for Advanced Imaging (CAI),
+//   The University of Queensland (UQ), Australia
+//
+//        jiaxin.du@uqconnect.edu.au
+//
+// Reference:
+//  Du J, Vegh V, & Reutens DC,
+//                PLOS Compt Biol 8(10): e1002733.
+//              & NeuroImage 94: 1-11.
+//
+// See README for software copyright statements.
+//-------------------------------------------------
+#include <iomanip>
+#include "src/simulation.h"
+
+using namespace std;
+
+//----------------------------------------
+//     Model compiler
+//
+// lcmc loads the model of a parameter file the way runlcm does
+// (Simulation::load(), without setting up the run: no processes are
+// started and no histories are allocated), and writes a translation
+// unit for the model: the parameter file and the constants of the
+// model (neuron groups, receptors and their PSP tables, synapses,
+// delays) are compiled in. The step reads them in
+// place of the loaded model (MODEL_SYNP in simulation.cpp): the sources
+// are gathered group by group (LCM_MODEL_GROUPS), so the loops over the
+// synapses have constant bounds, weights and delays, the decay of the
+// membrane potentials and the PSP tables are constants, and the sparse
+// engine only has the version of the numbers of its receptors
+// (Simulation::advance_sparse()). The unit includes the sources and
+// runlcm.cpp, so the program has the options, the log and the data
+// files of runlcm, without '-f'. The constants are checked against the
+// model loaded at the start, so a program compiled from other sources
+// stops
+//
+// Example:
+//   lcmc -f para.cfg -o v1.lcm.cpp
+//   make lcm_v1
+//   ./lcm_v1 -o volt.dat -l run.log
+//----------------------------------------
+
+//the sources of the program, as in the Makefile
+const char *SRC_LIST[] = { "array.cpp", "layer.cpp", "misc.cpp", "rand.cpp", "lcm.cpp",
+   "spikesrc.cpp", "synpconn.cpp", "exsource.cpp", "neurgrp.cpp", "receptor.cpp",
+   "stimulator.cpp", "simulation.cpp", "fft.cpp", "gather.cpp", "topology.cpp", "transport.cpp" };
+
+//return the command formate
+string cmd_format(string cmd)
+{
+   return string("\nformat: ") + cmd + \
+      string(" -f para_file -o cpp_file\n\n" \
+      "  -f para_file\t specify parameter configuration file (default: para.cfg).\n" \
+      "  -o cpp_file\t specify the translation unit written (default: model.lcm.cpp).\n\n" \
+      "the program of 'name.lcm.cpp' is built by 'make lcm_name'.\n\n");
+}
+
+//return str as a C++ string literal, a line of the text per line
+string cpp_literal(const string& str)
+{
+   ostringstream oss;
+   oss << "\"";
+   for (string::const_iterator it = str.begin(); it != str.end(); ++it) {
+      unsigned char c = static_cast<unsigned char>(*it);
+      if (c == '\\') oss << "\\\\";
+      else if (c == '"') oss << "\\\"";
+      else if (c == '\n') oss << "\\n\"\n   \"";
+      else if (c == '\t') oss << "\\t";
+      else if (c < 32 || c > 126) oss << "\\" << oct << setw(3) << setfill('0') << static_cast<int>(c) << dec;
+      else oss << *it;
+   }
+   oss << "\"";
+   return oss.str();
+}
+
+//write an array of constants, an array has at least one value
+template <class T>
+void write_array(ostream& os, const string& type, const string& name, vector<T> val)
+{
+   const bool empty = val.empty();
+   if (empty) val.push_back(T());
+
+   os << "const " << type << " " << name << "[] = {";
+   for (size_t idx = 0; idx < val.size(); ++idx) {
+      if (idx > 0) os << ",";
+      os << ((idx % 8 == 0) ? "\n   " : " ") << val[idx];
+   }
+   os << " };" << (empty ? " //none" : "") << "\n";
+}
+
+//write the translation unit of the model loaded by simu from para_file (text)
+void write_model(ostream& os, const Simulation& simu, const string& text, const string& para_file)
+{
+   time_t raw_tm;
+   time(&raw_tm);
+   char time_stamp[32];
+   strftime(time_stamp, 31, "%Y-%m-%d %H:%M:%S", localtime(&raw_tm));
+
+   os << "//--------------------------------------------------\n"
+      << "// Laminar cortex model compiled by lcmc from '" << para_file << "'\n"
+      << "// at " << time_stamp << ", see lcmc.cpp. Do not edit.\n"
+      << "//--------------------------------------------------\n"
+      << "#define LCM_MODEL\n"
+      << "#define LCM_MODEL_NE " << simu.rcpt_excit_num() << "\n"
+      << "#define LCM_MODEL_NI " << simu.rcpt_inhib_num() << "\n"
+      << "#define LCM_MODEL_GROUPS(X)";
+   for (TInt ineur = 0; ineur < simu.ng_num(); ++ineur) {
+      os << " X(" << ineur << ")";
+   }
+   os << "\n\n"
+      << "#include <algorithm>\n"
+      << "#include \"src/simulation.h\"\n\n"
+      << "namespace lcm_model {\n\n";
+
+   os << "const char cfg_file[] = " << cpp_literal(para_file) << ";\n\n";
+   os << "const char cfg_text[] =\n   " << cpp_literal(text) << ";\n\n";
+
+   os << "const TInt ng_num = " << simu.ng_num() << ";\n";
+   os << "const TInt rcpt_num = " << simu.rcpt_num() << ";\n";
+   os << "const TInt elmt_num = " << simu.elmt_num() << ";\n";
+   os << "const TInt total_step = " << simu.total_step() << ";\n\n";
+
+   os << setprecision(17);
+
+   //the receptors by index, with their PSP tables
+   vector<string> rcpt_name, psp_table;
+   vector<TInt> psp_size;
+   vector<TReal> rcpt_delay;
+   for (TInt ircpt = 0; ircpt < simu.rcpt_num(); ++ircpt) {
+      const Receptor& rc = simu.receptor(ircpt);
+      rcpt_name.push_back(cpp_literal(rc.name()));
+      psp_size.push_back(rc.psp_size());
+      rcpt_delay.push_back(rc.delay());
+
+      psp_table.push_back("psp_" + int2str(ircpt));
+      write_array(os, "TReal", psp_table.back(), vector<TReal>(rc.psp(), rc.psp() + rc.psp_size()));
+   }
+   write_array(os, "TReal* const", "psp_table", psp_table);
+   write_array(os, "TInt", "psp_size", psp_size);
+   write_array(os, "char*", "rcpt_name", rcpt_name);
+   write_array(os, "TReal", "rcpt_delay", rcpt_delay);
+   os << "\n";
+
+   //the neuron groups and their synapses, ng_rcpt[ineur * rcpt_num + ircpt] is 
+   //the receptor ircpt of the input from the group ineur (gRcpt_excit or gRcpt_inhib)
+   vector<string> ng_name, ng_type;
+   vector<TReal> ng_V_0, ng_V_rev, ng_mp_decay_step;
+   vector<TInt> ng_rcpt, delay_max, synp_ptr(1, 0), synp_postsynp, synp_spk_delay, synp_psp_delay;
+   vector<TReal> synp_weight;
+   for (TInt ineur = 0; ineur < simu.ng_num(); ++ineur) {
+      const NeurGrp& ng = simu.neur_group(ineur);
+      ng_name.push_back(cpp_literal(ng.name()));
+      ng_type.push_back((ng.type() == cEXCIT) ? "cEXCIT" : "cINHIB");
+      ng_V_0.push_back(ng.V_0());
+      ng_V_rev.push_back(ng.V_rev());
+      ng_mp_decay_step.push_back(ng.mp_decay_step());
+      delay_max.push_back(simu.conn_delay_max(ineur));
+      for (TInt ircpt = 0; ircpt < simu.rcpt_num(); ++ircpt) {
+         if (ng.type() == cEXCIT) ng_rcpt.push_back((ircpt < simu.rcpt_excit_num()) ? simu.rcpt_excit(ircpt).index() : -1);
+         else ng_rcpt.push_back((ircpt < simu.rcpt_inhib_num()) ? simu.rcpt_inhib(ircpt).index() : -1);
+      }
+      for (vector<SynpConn>::const_iterator sy_it = ng.synp_conn().begin(); sy_it != ng.synp_conn().end(); ++sy_it) {
+         synp_postsynp.push_back(sy_it->postsynp());
+         synp_spk_delay.push_back(sy_it->spk_delay());
+         synp_psp_delay.push_back(sy_it->psp_delay());
+         synp_weight.push_back(sy_it->weight());
+      }
+      synp_ptr.push_back(synp_postsynp.size());
+   }
+   write_array(os, "char*", "ng_name", ng_name);
+   write_array(os, "TNeur", "ng_type", ng_type);
+   write_array(os, "TReal", "ng_V_0", ng_V_0);
+   write_array(os, "TReal", "ng_V_rev", ng_V_rev);
+   write_array(os, "TReal", "ng_mp_decay_step", ng_mp_decay_step);
+   write_array(os, "TInt", "ng_rcpt", ng_rcpt);
+   write_array(os, "TInt", "conn_delay_max", delay_max);
+   write_array(os, "TInt", "synp_ptr", synp_ptr);
+   write_array(os, "TInt", "synp_postsynp", synp_postsynp);
+   write_array(os, "TInt", "synp_spk_delay", synp_spk_delay);
+   write_array(os, "TInt", "synp_psp_delay", synp_psp_delay);
+   write_array(os, "TReal", "synp_weight", synp_weight);
+
+   //the check at the start, see runlcm.cpp
+   os << "\n"
+      << "//return an empty string if the model loaded from cfg_text has the constants,\n"
+      << "//else the first one it differs in\n"
+      << "std::string check(const Simulation& simu)\n"
+      << "{\n"
+      << "   if (simu.ng_num() != ng_num || simu.rcpt_num() != rcpt_num || simu.elmt_num() != elmt_num\n"
+      << "      || simu.total_step() != total_step) return \"the numbers of the model\";\n"
+      << "   if (simu.rcpt_excit_num() != LCM_MODEL_NE || simu.rcpt_inhib_num() != LCM_MODEL_NI) return \"the receptors\";\n\n"
+      << "   for (TInt ircpt = 0; ircpt < rcpt_num; ++ircpt) {\n"
+      << "      const Receptor& rc = simu.receptor(ircpt);\n"
+      << "      if (rc.name() != rcpt_name[ircpt] || rc.delay() != rcpt_delay[ircpt] || rc.psp_size() != psp_size[ircpt]\n"
+      << "         || !std::equal(rc.psp(), rc.psp() + rc.psp_size(), psp_table[ircpt]))\n"
+      << "         return std::string(\"the receptor \") + rcpt_name[ircpt];\n"
+      << "   }\n\n"
+      << "   for (TInt ineur = 0; ineur < ng_num; ++ineur) {\n"
+      << "      const NeurGrp& ng = simu.neur_group(ineur);\n"
+      << "      if (ng.name() != ng_name[ineur] || ng.type() != ng_type[ineur] || ng.V_0() != ng_V_0[ineur]\n"
+      << "         || ng.V_rev() != ng_V_rev[ineur] || ng.mp_decay_step() != ng_mp_decay_step[ineur]\n"
+      << "         || simu.conn_delay_max(ineur) != conn_delay_max[ineur]\n"
+      << "         || static_cast<TInt>(ng.synp_conn().size()) != synp_ptr[ineur + 1] - synp_ptr[ineur])\n"
+      << "         return std::string(\"the neuron group \") + ng_name[ineur];\n"
+      << "      const TInt rc_num = (ng.type() == cEXCIT) ? LCM_MODEL_NE : LCM_MODEL_NI;\n"
+      << "      for (TInt ircpt = 0; ircpt < rc_num; ++ircpt) {\n"
+      << "         const Receptor& rc = (ng.type() == cEXCIT) ? simu.rcpt_excit(ircpt) : simu.rcpt_inhib(ircpt);\n"
+      << "         if (rc.index() != ng_rcpt[ineur * rcpt_num + ircpt])\n"
+      << "            return std::string(\"the receptors of \") + ng_name[ineur];\n"
+      << "      }\n"
+      << "      for (TInt isynp = synp_ptr[ineur]; isynp < synp_ptr[ineur + 1]; ++isynp) {\n"
+      << "         const SynpConn& sy = ng.synp_conn()[isynp - synp_ptr[ineur]];\n"
+      << "         if (sy.postsynp() != synp_postsynp[isynp] || sy.spk_delay() != synp_spk_delay[isynp]\n"
+      << "            || sy.psp_delay() != synp_psp_delay[isynp] || sy.weight() != synp_weight[isynp])\n"
+      << "            return std::string(\"the synapses of \") + ng_name[ineur];\n"
+      << "      }\n"
+      << "   }\n\n"
+      << "   return \"\";\n"
+      << "}\n\n"
+      << "} //namespace lcm_model\n\n";
+
+   for (size_t isrc = 0; isrc < sizeof(SRC_LIST) / sizeof(SRC_LIST[0]); ++isrc) {
+      os << "#include \"src/" << SRC_LIST[isrc] << "\"\n";
+   }
+   os << "#include \"runlcm.cpp\"\n";
+}
+
+int main(int argc, char **argv)
+{
+   string para_file = "para.cfg";
+   string cpp_file = "model.lcm.cpp";
+
+   //deal with command argument
+   for (TInt idx = 1; idx < argc; idx += 2) {
+      if (strcmp(argv[idx], "-f") == 0 && idx + 1 < argc) {
+         para_file = strtrim(argv[idx + 1]);
+      }
+      else if (strcmp(argv[idx], "-o") == 0 && idx + 1 < argc) {
+         cpp_file = strtrim(argv[idx + 1]);
+      }
+      else {
+         cerr << "ERROR: unrecognised option '" << argv[idx] << "'." << endl;
+         cerr << cmd_format(argv[0]) << endl;
+         cerr.flush();
+         exit(-1);
+      }
+   }
+
+   ifstream fp(para_file.c_str());
+   if (!fp.good()) {
+      cerr << "ERROR: failed to open file '" << para_file << "'." << endl;
+      exit(-1);
+   }
+   string text((istreambuf_iterator<char>(fp)), istreambuf_iterator<char>());
+   fp.close();
+
+   //only the model is loaded, the options of the run are checked when the program starts
+   Simulation simu;
+   simu.load_from_text(text, para_file, true);
+
+   ofstream fout(cpp_file.c_str());
+   if (!fout.good()) {
+      cerr << "ERROR: failed to open file '" << cpp_file << "' for writing." << endl;
+      exit(-1);
+   }
+   write_model(fout, simu, text, para_file);
+   fout.close();
+
+   string name = cpp_file.substr(cpp_file.find_last_of("/\\") + 1);
+   if (name.size() > 8 && name.compare(name.size() - 8, 8, ".lcm.cpp") == 0) name.erase(name.size() - 8);
+
+   cout << endl << "INFO: model of '" << para_file << "' (" << simu.ng_num() << " neuron groups, "
+      << simu.rcpt_excit_num() << " + " << simu.rcpt_inhib_num() << " receptors) written to '" << cpp_file << "'." << endl;
+   cout << "INFO: build it with 'make lcm_" << name << "'." << endl;
+
+   return 0;
+}
@@ -434,13 +434,18 @@ Int_t main(Int_t argc, char* argv[])
             mFR_I[ielmt] = 0.;
         }
 
+        //the firing rates of a neuron group over all the elements, 
+        //from the tables of LCM.FIRE_TOL if set
+#pragma omp parallel for 
+        for (Int_t ineur = 0; ineur < ng_num; ++ineur) {
+            lcm.neur_group(ineur).eqn_firing(volt + ineur, ng_num, FR + ineur, ng_num, elmt_num);
+        }
+
 #pragma omp parallel for 
         for (Int_t ielmt = 0; ielmt < elmt_num; ++ielmt) {
             Int_t idx = ielmt * ng_num;
 
             for (Int_t ineur = 0; ineur < ng_num; ++ineur) {
-                FR[idx] = lcm.neur_group(ineur).eqn_firing(volt[idx]);
-
                 if (neur_type[ineur] == cEXCIT) {
                     mFR_E[ielmt] += (FR[idx] * neur_density[ineur]);
                 }
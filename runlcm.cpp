@@ -26,11 +26,13 @@ using namespace std;
 string cmd_format(string cmd)
 {
    return string("\nformat: ") + cmd + \
-      string(" -p prefix -f para_file -o dat_file -l log_file\n\n" \
+      string(" -p prefix -f para_file -o dat_file -l log_file [-b tol]\n\n" \
       "  -p prefix\t specify the directory for all files (default: NONE).\n" \
       "  -f para_file\t specify parameter configuration file (default: para.cfg).\n" \
       "  -o dat_file\t specify voltage data output file (default: voltage_<time_stamp>.dat).\n" \
-      "  -l log_file\t specify the runing log output file (default: run_<time_stamp>.log).\n\n" \
+      "  -l log_file\t specify the runing log output file (default: run_<time_stamp>.log).\n" \
+      "  -b tol\t time the firing functions with tables of the error tol (see LCM.FIRE_TOL)\n" \
+      "        \t against exp(), print the speed and the error and exit.\n\n" \
       "if a prefix is specified, it will add to all file names " \
       "that does not contain a '\\' or '/'. \n\n" \
       "for example :\n\n  ") + cmd + \
@@ -65,6 +67,56 @@ string banner()
       );
 }
 
+//time the firing function of every neuron group with a table of the 
+//error tol against exp(), over membrane potentials spread evenly in 
+//[min_volt(), max_volt()], and return the speed and the largest error
+string bench_firing(const Simulation& simu, const TReal& tol)
+{
+   const TInt num = 1 << 16;
+   const TInt rep = 64;
+
+   vector<TReal> volt(num), exact(num), table(num);
+   for (TInt idx = 0; idx < num; ++idx) {
+      TReal x = idx * 0.6180339887498949;
+      volt[idx] = simu.min_volt() + (simu.max_volt() - simu.min_volt()) * (x - floor(x));
+   }
+
+   ostringstream oss;
+   TReal sum = 0.;
+   for (TInt ineur = 0; ineur < simu.ng_num(); ++ineur) {
+      NeurGrp ng = simu.neur_group(ineur);
+
+      clock_t bgn = clock();
+      for (TInt irep = 0; irep < rep; ++irep) {
+         for (TInt idx = 0; idx < num; ++idx) exact[idx] = ng.eqn_firing_exact(volt[idx]);
+         sum += exact[irep];
+      }
+      TReal t_exact = static_cast<TReal>(clock() - bgn) / CLOCKS_PER_SEC;
+
+      if (!ng.set_fire_table(simu.min_volt(), simu.max_volt(), tol)) {
+         oss << "  " << ng.name() << ":\t the table needs more than " << FIRE_TABLE_MAX << " intervals.\n";
+         continue;
+      }
+
+      bgn = clock();
+      for (TInt irep = 0; irep < rep; ++irep) {
+         ng.eqn_firing(volt.data(), 1, table.data(), 1, num);
+         sum += table[irep];
+      }
+      TReal t_table = static_cast<TReal>(clock() - bgn) / CLOCKS_PER_SEC;
+
+      TReal err = 0.;
+      for (TInt idx = 0; idx < num; ++idx) err = std::max(err, std::abs(table[idx] - exact[idx]));
+
+      oss << "  " << ng.name() << ":\t exp() " << 1e9 * t_exact / (static_cast<TReal>(num) * rep)
+         << " ns, table " << 1e9 * t_table / (static_cast<TReal>(num) * rep) << " ns per value ("
+         << ng.fire_table_size() << " intervals), error " << err / ng.fire_max() << " of FIRE_MAX.\n";
+   }
+   oss << "  (checksum " << sum << ")\n";
+
+   return oss.str();
+}
+
 int main(int argc, char **argv)
 {
 #ifdef _OPENMP
@@ -85,12 +137,26 @@ int main(int argc, char **argv)
    string para_file = "para.cfg";
    string dat_file = string("volt_") + time_stamp + string(".dat");
    string log_file = string("run_") + time_stamp + string(".log");
+   TReal bench_tol = 0.;
+
+#ifdef LCM_MODEL
+   //the parameters are compiled in, see lcmc.cpp
+   para_file = lcm_model::cfg_file;
+#endif
 
    //deal with command argument
    for (TInt idx = 1; idx < argc; idx += 2){
+#ifdef LCM_MODEL
+      if (strcmp(argv[idx], "-f") == 0) {
+         cerr << "ERROR: the parameters of '" << para_file << "' are compiled in, option '-f' is not used." << endl;
+         cerr.flush();
+         exit(-1);
+      }
+#else
       if (strcmp(argv[idx], "-f") == 0) {
          para_file = strtrim(argv[idx + 1]);
       }
+#endif
       else if (strcmp(argv[idx], "-p") == 0){
          prefix = strtrim(argv[idx + 1]);
       }
@@ -100,6 +166,13 @@ int main(int argc, char **argv)
       else if (strcmp(argv[idx], "-l") == 0){
          log_file = strtrim(argv[idx + 1]);
       }
+      else if (strcmp(argv[idx], "-b") == 0 && idx + 1 < argc){
+         if (!str2float(strtrim(argv[idx + 1]), bench_tol) || bench_tol <= 0.) {
+            cerr << "ERROR: invalid tolerance '" << argv[idx + 1] << "' of option '-b'." << endl;
+            cerr.flush();
+            exit(-1);
+         }
+      }
       else{
          cerr << "ERROR: unrecognised option '" << argv[idx] << "'." << endl;
          cerr << cmd_format(argv[0]) << endl;
@@ -111,6 +184,7 @@ int main(int argc, char **argv)
    //add prefix to file names
    if (!prefix.empty()){
 
+#ifndef LCM_MODEL
       if (para_file.find_first_of("/\\") == string::npos){
          if (prefix[prefix.size() - 1] == FILE_PATH_SEP){
             para_file = prefix + para_file;
@@ -119,6 +193,7 @@ int main(int argc, char **argv)
             para_file = prefix + FILE_PATH_SEP + para_file;
          }
       }
+#endif
 
       if (dat_file.find_first_of("/\\") == string::npos){
          if (prefix[prefix.size() - 1] == FILE_PATH_SEP){
@@ -170,7 +245,11 @@ int main(int argc, char **argv)
 #endif
 
    //print out input and output file information
+#ifdef LCM_MODEL
+   cout << "INFO: use parameter file '" << para_file << "' compiled in." << endl;
+#else
    cout << "INFO: use parameter file '" << para_file << "'." << endl;
+#endif
    cout << "INFO: write voltage data to '" << dat_file << "'." << endl;
    cout << "INFO: redirect runing log to file '" << log_file << "'." << endl;
    cout << endl;
@@ -181,23 +260,71 @@ int main(int argc, char **argv)
    flog << "//INFO: redirect runing log to file '" << log_file << "'." << endl;
    flog << endl;
 
+   //the processes of a distributed run are forked while the parameters are loaded, 
+   //so nothing must be left in the buffer of the log file, see SIMU.PROC_NUM
+   flog.flush();
+
    //Create a simulation object
    Simulation simu;
 
    //load the parameter values from the paramter file
+#ifdef LCM_MODEL
+   simu.load_from_text(lcm_model::cfg_text, para_file);
+
+   string model_diff = lcm_model::check(simu);
+   if (!model_diff.empty()) {
+      cerr << "ERROR: the model loaded differs from the compiled one in " << model_diff 
+         << ", compile '" << para_file << "' again with lcmc." << endl;
+      cerr.flush();
+      exit(-1);
+   }
+#else
    simu.load_from_file(para_file);
+#endif
 
-#ifdef _OPENMP
-   TInt Nproc = omp_get_num_procs();//get the number of available processors without hyper-threading.
-   if (Nproc > 25) Nproc = 25;
-   if (Nproc > simu.thread_num() && simu.thread_num() > 0) Nproc = simu.thread_num();
+   //the benchmark of the firing functions, the model is not run
+   if (bench_tol > 0.) {
+      if (simu.proc_rank() == 0) {
+         cout << "INFO: firing functions with tables of the error " << bench_tol << ":" << endl;
+         cout << bench_firing(simu, bench_tol) << endl;
+      }
+      flog.close();
+      return 0;
+   }
 
-   omp_set_num_threads(Nproc);//set the number of processors.
-   omp_set_nested(0);
-   omp_set_dynamic(1);
+   //print voltage info on the screen every 1 sec
+   TInt print_dt = static_cast<TInt>(1000. / simu.time_step());
+   TInt print_step = print_dt;
+
+   TInt ctr_pnt = simu.elmt_num() / 2 - simu.grid_row() / 2; //cntr of simulated area
+   vector<TReal> ctr_volt;
 
-   cout << "INFO: Program is running on " << omp_get_max_threads() << " threads." << endl << endl;
-   flog << "//INFO: Program is running on " << omp_get_max_threads() << " threads." << endl << endl;
+   vector<char> buff; //data buffer
+
+   //the other processes of a distributed run advance their part of the grid and 
+   //send the data to the first one, which writes the files, see Simulation::get_volt()
+   if (simu.proc_rank() > 0) {
+      flog.close();
+      while (simu.evlt_step() != simu.total_step()) {
+         simu.advance(print_step - simu.evlt_step());
+         if (simu.evlt_step() == print_step) {
+            simu.get_volt(ctr_pnt, ctr_volt);
+            print_step += print_dt;
+         }
+         if (simu.is_out()) simu.get_data_block(buff);
+      }
+      return 0;
+   }
+
+#ifdef _OPENMP
+   //the threads are set up from SIMU.THREAD_NUM and SIMU.THREAD_PIN, see Simulation::init_thread()
+   ostringstream thrd_info;
+   thrd_info << "INFO: Program is running on " << omp_get_max_threads() << " threads"
+      << (simu.proc_num() > 1 ? " in each of " + int2str(simu.proc_num()) + " processes" : "") << " ("
+      << (simu.thread_pinned() ? "pinned, " : "") << simu.topology().print() << ").";
+
+   cout << thrd_info.str() << endl << endl;
+   flog << "//" << thrd_info.str() << endl << endl;
 #endif
 
    //log the basic infomation of the simulation
@@ -213,10 +340,6 @@ int main(int argc, char **argv)
    flog << simu.get_cfg() << endl;
    flog << "//------------- parameter settings end -------------" << endl << endl;
 
-   //print voltage info on the screen every 1 sec
-   TInt print_dt = static_cast<TInt>(1000. / simu.time_step());
-   TInt print_step = print_dt;
-
    //voltage data file
    ofstream fout(dat_file.c_str(), std::ofstream::binary);
    if (!fout.good()){
@@ -232,12 +355,34 @@ int main(int argc, char **argv)
    //    info (1024)     configure (cfg_len)     data (data_len)
    //|<--------------- header ---------------->|
 
-   vector<char> buff; //data buffer
-
    simu.get_data_header(buff); //get data header
 
    fout.write(&(buff.front()), buff.size()); //write the header to file
 
+   //the other members of an ensemble are written to the files of dat_file 
+   //with the member before the extension, e.g. 'volt.m1.dat', see SIMU.ENSEMBLE
+   vector<ofstream*> fens;
+   for (TInt iens = 1; iens < simu.ens_num(); ++iens) {
+      string ens_file = dat_file;
+      size_t ext = ens_file.find_last_of('.');
+      if (ext == string::npos || ens_file.find_first_of("/\\", ext) != string::npos) ext = ens_file.size();
+      ens_file.insert(ext, ".m" + int2str(iens));
+
+      fens.push_back(new ofstream(ens_file.c_str(), std::ofstream::binary));
+      if (!fens.back()->good()) {
+         cerr << "ERROR: open output file '" << ens_file << "'!" << endl;
+         flog << "ERROR: open output file '" << ens_file << "'!" << endl;
+         cerr.flush();
+         flog.close();
+         exit(-1);
+      }
+      cout << "INFO: write voltage data of ensemble member " << iens << " to '" << ens_file << "'." << endl;
+      flog << "//INFO: write voltage data of ensemble member " << iens << " to '" << ens_file << "'." << endl;
+
+      simu.get_data_header(buff, iens);
+      fens.back()->write(&(buff.front()), buff.size());
+   }
+
    time(&raw_tm);
    strftime(time_stamp, 31, "%Y-%m-%d %H:%M:%S", localtime(&raw_tm));
    flog << "//INFO: simulation started at " << time_stamp << "." << endl;
@@ -247,18 +392,18 @@ int main(int argc, char **argv)
 
    time(&bgn_tm); //receord the beginning time
 
-   TInt ctr_pnt = simu.elmt_num() / 2 - simu.grid_row() / 2; //cntr of simulated area
-
    while (simu.evlt_step() != simu.total_step()){
 
-      simu.advance();
+      //up to the next print out, the steps are run in blocks, see Simulation::advance(const TInt&)
+      simu.advance(print_step - simu.evlt_step());
 
       //print out voltage info to the screen regularly
       if (simu.evlt_step() == print_step){
+         simu.get_volt(ctr_pnt, ctr_volt);
          cout << "time = " << simu.evlt_time() << " sec" << endl;
          for (TInt ineur = 0; ineur < simu.ng_num(); ++ineur){
             cout << "  " << simu.neur_name(ineur) << ":\t" << setw(5) \
-               << simu.Volt(ctr_pnt, ineur) << endl;
+               << ctr_volt[ineur] << endl;
          }
 
          time(&raw_tm);
@@ -278,10 +423,19 @@ int main(int argc, char **argv)
          simu.get_data_block(buff);
          //write voltage info
          fout.write(&(buff.front()), buff.size());
+
+         for (TInt iens = 1; iens < simu.ens_num(); ++iens) {
+            simu.get_data_block(buff, iens);
+            fens[iens - 1]->write(&(buff.front()), buff.size());
+         }
       }
    }
 
    fout.close(); //close the file
+   for (vector<ofstream*>::iterator it = fens.begin(); it != fens.end(); ++it) {
+      (*it)->close();
+      delete *it;
+   }
 
    time(&raw_tm);
    sec_elapsed = difftime(raw_tm, bgn_tm); //calculate elapsed time
@@ -291,6 +445,42 @@ int main(int argc, char **argv)
    flog << "//INFO: simulation finished at " << time_stamp << "." << endl;
    flog << "//INFO: total running time = " << sec2str(sec_elapsed) << "." << endl;
 
+   //deviation of the single precision gather, see Simulation::precision()
+   if (simu.precision() == PRECISION_VALIDATE) {
+      ostringstream oss;
+      oss << "INFO: synaptic input in single precision deviates by at most " << simu.prec_deviation()
+         << " from double precision (" << simu.prec_deviation() / std::max(simu.prec_magnitude(), VOLT_EPS) 
+         << " of the largest input).";
+      cout << oss.str() << endl;
+      flog << "//" << oss.str() << endl;
+   }
+
+   //deviation of the recursive kernels, see Simulation::psp_kernel()
+   if (simu.psp_kernel() == KERNEL_VALIDATE) {
+      ostringstream oss;
+      oss << "INFO: membrane potential of the recursive receptor kernels deviates by at most " 
+         << simu.iir_deviation() << " mV from that of the time courses.";
+      cout << oss.str() << endl;
+      flog << "//" << oss.str() << endl;
+   }
+
+   //steps of ENGINE_AUTO run with the push, see Simulation::advance_push()
+   if (simu.engine() == ENGINE_AUTO) {
+      ostringstream oss;
+      oss << "INFO: push engine was used in " << simu.push_steps() << " of " << simu.evlt_step() << " steps.";
+      cout << oss.str() << endl;
+      flog << "//" << oss.str() << endl;
+   }
+
+   //work skipped by the activity gating, see Simulation::gate_eps()
+   if (simu.gate_eps() > 0.) {
+      ostringstream oss;
+      oss << "INFO: activity gating (tolerance " << simu.gate_eps() << " mV) skipped " 
+         << 100. * simu.gate_skipped() << "% of the connection entries.";
+      cout << oss.str() << endl;
+      flog << "//" << oss.str() << endl;
+   }
+
    flog.close();
    //char ch;
    //cin>>ch;
@@ -229,4 +229,116 @@ public:
     std::string print(void) const;
 };
 
+//----------------------------------------
+//            Touch Allocator
+//
+// An allocator for std::vector that leaves the elements 
+// added by resize() uninitialised, so the pages of a large
+// table are placed (first touch) on the NUMA node of the 
+// thread that writes them first, not of the thread that 
+// resizes the vector
+//----------------------------------------
+template <typename T>
+class TouchAllocator : public std::allocator<T>
+{
+public:
+    template <typename U> struct rebind { typedef TouchAllocator<U> other; };
+
+    TouchAllocator(void) {};
+    template <typename U> TouchAllocator(const TouchAllocator<U>&) {};
+
+    //default initialisation, nothing is written for the numbers
+    template <typename U> void construct(U* p) { ::new(static_cast<void*>(p)) U; };
+    template <typename U> void construct(U* p, const U& val) { ::new(static_cast<void*>(p)) U(val); };
+};
+
+//----------------------------------------
+//            Aligned Array
+//
+// A fixed-size block of T whose first element is aligned 
+// to ALIGNED_ARRAY_BYTES, used as an arena for many histories 
+// of the same length that are indexed by the caller
+//----------------------------------------
+#ifndef ALIGNED_ARRAY_BYTES
+#define ALIGNED_ARRAY_BYTES 64
+#endif
+
+template <typename T>
+class AlignedArray
+{
+private:
+    T*     _p_mem;  //allocated memory
+    T*     _p_bgn;  //aligned beginning of the data
+    size_t _f_size; //number of the elements
+
+    //no copy
+    AlignedArray(const AlignedArray&);
+    AlignedArray& operator= (const AlignedArray&);
+
+public:
+    AlignedArray(void) : _p_mem(NULL), _p_bgn(NULL), _f_size(0) {};
+
+    ~AlignedArray(void) { clear(); };
+
+    //resize the array and set all the values to val, the old data are discarded
+    void resize(const size_t& size, const T& val = T(0)) {
+        allocate(size);
+        fill(val);
+    };
+
+    //resize the array without setting the values, so the pages are placed
+    //by the threads writing them first, the old data are discarded
+    void allocate(const size_t& size) {
+        clear();
+
+        if (size == 0) return;
+
+        const size_t pad = ALIGNED_ARRAY_BYTES / sizeof(T);
+
+        try {
+            _p_mem = new T[size + pad];
+        }
+        catch (std::bad_alloc &e) {
+            std::cerr << MEMORY_ERROR << std::endl << e.what() << std::endl;
+            exit(-1);
+        }
+
+        //move the beginning forward to the next aligned address
+        size_t shift = reinterpret_cast<size_t>(_p_mem) % ALIGNED_ARRAY_BYTES;
+        _p_bgn = _p_mem + (shift == 0 ? 0 : (ALIGNED_ARRAY_BYTES - shift) / sizeof(T));
+        _f_size = size;
+    };
+
+    //delete the allocated memory
+    void clear(void) {
+        if (_p_mem != NULL) {
+            delete[] _p_mem;
+        }
+        _p_mem = NULL;
+        _p_bgn = NULL;
+        _f_size = 0;
+    };
+
+    inline size_t size(void) const { return _f_size; };
+
+    inline bool empty(void) const { return _f_size == 0; };
+
+    inline void fill(const T& val) {
+        std::fill(_p_bgn, _p_bgn + _f_size, val);
+    };
+
+    inline T* data(void) { return _p_bgn; };
+    inline const T* data(void) const { return _p_bgn; };
+
+    inline T& operator[] (const size_t& idx) {
+        assert(idx < _f_size);
+        return _p_bgn[idx];
+    };
+
+    inline const T& operator[] (const size_t& idx) const {
+        assert(idx < _f_size);
+        return _p_bgn[idx];
+    };
+};
+
 #endif /* end of #ifndef ARRAY_H */
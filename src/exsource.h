@@ -82,6 +82,9 @@ public:
     //return the name of a stimulator
     std::string stim_name(const TInt& idx) const { return _es_stim[idx].name(); };
 
+    //return a stimulator
+    const Stimulator& stim(const TInt& idx) const { return _es_stim[idx]; };
+
     //initialize the external source
     // this function will set the status flag: _es_state
     // always call this function before checking is_ready()
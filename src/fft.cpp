@@ -0,0 +1,159 @@
+//-------------------------------------------------
+//
+//          Laminar cortex model
+//
+// Developed by Jiaxin Du under the supervision of
+//    Prof. David Reutens and Dr. Viktor Vegh
+//
+//       Centre for Advanced Imaging (CAI),
+//   The University of Queensland (UQ), Australia
+//
+//        jiaxin.du@uqconnect.edu.au
+//
+// Reference:
+//  Du J, Vegh V, & Reutens DC,
+//                PLOS Compt Biol 8(10): e1002733.
+//              & NeuroImage 94: 1-11.
+//
+// See README for software copyright statements.
+//-------------------------------------------------
+#include "fft.h"
+
+using namespace std;
+
+//----------------------------------------
+// function: void FFT::resize(const TInt& n)
+//   Factorise n and set up the twiddle factors 
+//----------------------------------------
+void FFT::resize(const TInt& n)
+{
+    assert(n > 0);
+
+    _n = n;
+    _max_radix = 1;
+    _factor.clear();
+
+    //radix 2 first, the butterflies of small radices are the cheapest 
+    TInt m = n;
+    TInt p = 2;
+    while (m > 1) {
+        while (m % p != 0) {
+            ++p;
+            if (p * p > m) p = m;
+        }
+        m /= p;
+        _factor.push_back(p);
+        _factor.push_back(m);
+        _max_radix = std::max(_max_radix, p);
+    }
+
+    if (_factor.empty()) { // n == 1
+        _factor.push_back(1);
+        _factor.push_back(1);
+    }
+
+    const TReal two_pi = 6.283185307179586;
+
+    _tw_fwd.resize(n);
+    _tw_bwd.resize(n);
+    for (TInt k = 0; k < n; ++k) {
+        _tw_fwd[k] = polar(1.0, -two_pi * k / n);
+        _tw_bwd[k] = conj(_tw_fwd[k]);
+    }
+}
+
+//----------------------------------------
+// function: void FFT::work(TComplex* out, const TComplex* in, const TInt& fstride, 
+//           const TInt& istride, const TInt* factor, const TComplex* tw, TComplex* scratch) const
+//   Transform the sub-sequence in[j*fstride*istride] of length p*m, where 
+//   (p, m) == (factor[0], factor[1]), and save the result in out[0 .. p*m-1]
+//
+//   The p sub-sequences of length m are transformed recursively, then
+//   combined by radix-p butterflies
+//     out[k + q1*m] = sum_q2 sub_q2[k] * tw[fstride*q2*(k + q1*m) % n]
+//----------------------------------------
+void FFT::work(TComplex* out, const TComplex* in, const TInt& fstride, const TInt& istride,
+    const TInt* factor, const TComplex* tw, TComplex* scratch) const
+{
+    const TInt p = factor[0];
+    const TInt m = factor[1];
+
+    if (m == 1) {
+        for (TInt q = 0; q < p; ++q) {
+            out[q] = in[q * fstride * istride];
+        }
+    }
+    else {
+        for (TInt q = 0; q < p; ++q) {
+            work(out + q * m, in + q * fstride * istride, fstride * p, istride, factor + 2, tw, scratch);
+        }
+    }
+
+    if (p == 1) return;
+
+    if (p == 2) {
+        TComplex t;
+        for (TInt k = 0; k < m; ++k) {
+            t = out[k + m] * tw[k * fstride];
+            out[k + m] = out[k] - t;
+            out[k] += t;
+        }
+        return;
+    }
+
+    TInt idx, tw_idx, tw_step;
+    TComplex acc;
+    for (TInt k = 0; k < m; ++k) {
+        for (TInt q = 0; q < p; ++q) {
+            scratch[q] = out[k + q * m];
+        }
+
+        for (TInt q1 = 0; q1 < p; ++q1) {
+            idx = k + q1 * m;
+            tw_step = fstride * idx; // < _n
+            tw_idx = 0;
+            acc = scratch[0];
+            for (TInt q2 = 1; q2 < p; ++q2) {
+                tw_idx += tw_step;
+                if (tw_idx >= _n) tw_idx -= _n;
+                acc += scratch[q2] * tw[tw_idx];
+            }
+            out[idx] = acc;
+        }
+    }
+}
+
+//----------------------------------------
+// function: void FFT2D::transform(TComplex* data, TComplex* work, const bool& inverse) const
+//   Transform the rows, and then the columns of data in place
+//
+//   work[0 .. row()-1] keeps a copy of a row, 
+//   work[row() .. 2*row()-1] keeps the transform of a column
+//----------------------------------------
+void FFT2D::transform(TComplex* data, TComplex* work, const bool& inverse) const
+{
+    const TInt n = _fft.size();
+
+    TComplex *line = work;
+    TComplex *col = work + n;
+    TComplex *scratch = work + 2 * n;
+
+    for (TInt irow = 0; irow < n; ++irow) {
+        std::copy(data + irow * n, data + (irow + 1) * n, line);
+        if (inverse)
+            _fft.backward(line, 1, data + irow * n, scratch);
+        else
+            _fft.forward(line, 1, data + irow * n, scratch);
+    }
+
+    for (TInt icol = 0; icol < n; ++icol) {
+        if (inverse)
+            _fft.backward(data + icol, n, col, scratch);
+        else
+            _fft.forward(data + icol, n, col, scratch);
+
+        for (TInt irow = 0; irow < n; ++irow) {
+            data[icol + irow * n] = col[irow];
+        }
+    }
+}
@@ -0,0 +1,123 @@
+//-------------------------------------------------
+//
+//          Laminar cortex model
+//
+// Developed by Jiaxin Du under the supervision of
+//    Prof. David Reutens and Dr. Viktor Vegh
+//
+//       Centre for Advanced Imaging (CAI),
+//   The University of Queensland (UQ), Australia
+//
+//        jiaxin.du@uqconnect.edu.au
+//
+// Reference:
+//  Du J, Vegh V, & Reutens DC,
+//                PLOS Compt Biol 8(10): e1002733.
+//              & NeuroImage 94: 1-11.
+//
+// See README for software copyright statements.
+//-------------------------------------------------
+#pragma once
+
+#ifndef FFT_H
+#define FFT_H
+
+//----------------------------------------
+//         Fast Fourier Transform
+//
+// FFT computes the discrete Fourier transform of 
+// a sequence of any length n, using the mixed-radix
+// (decimation in time) Cooley-Tukey algorithm. n is 
+// factorised into primes, the radix-p butterflies are 
+// O(p) per point, so the transform is O(n log n) for 
+// smooth n and degrades to O(n*p) for a large prime p
+//
+// FFT2D applies FFT to the rows and the columns of 
+// a n x n array, saved in row-major order, which is 
+// how the elements of the grid are numbered
+//
+// Example:
+//   FFT2D fft(n);
+//   std::vector<TComplex> work(fft.work_size());
+//   fft.forward(data, &work[0]);
+//   fft.backward(data, &work[0]); // data * n * n
+//
+// The transforms are not normalised. The objects 
+// are not changed by the transforms, so one object 
+// can be shared by threads with separate work arrays
+//----------------------------------------
+
+#include "misc.h"
+#include <complex>
+#include <vector>
+
+typedef std::complex<TReal> TComplex;
+
+class FFT
+{
+private:
+    TInt _n;  // length of the sequence
+    TInt _max_radix;
+
+    std::vector<TInt> _factor;  // pairs of (radix p, length of sub-sequence m)
+    std::vector<TComplex> _tw_fwd;  // exp(-2*pi*i*k/n)
+    std::vector<TComplex> _tw_bwd;  // exp(+2*pi*i*k/n)
+
+    void work(TComplex* out, const TComplex* in, const TInt& fstride, const TInt& istride,
+        const TInt* factor, const TComplex* tw, TComplex* scratch) const;
+
+public:
+    FFT(const TInt& n = 0) : _n(0), _max_radix(0) {
+        if (n > 0) resize(n);
+    };
+
+    //set the length of the sequence
+    void resize(const TInt& n);
+
+    //return the length of the sequence
+    inline TInt size(void) const { return _n; };
+
+    //return the number of TComplex needed by scratch
+    inline TInt scratch_size(void) const { return _max_radix; };
+
+    //out[k] = sum_j in[j*istride] * exp(-2*pi*i*j*k/n), in and out must not overlap
+    inline void forward(const TComplex* in, const TInt& istride, TComplex* out, TComplex* scratch) const {
+        work(out, in, 1, istride, &_factor[0], &_tw_fwd[0], scratch);
+    };
+
+    //out[k] = sum_j in[j*istride] * exp(+2*pi*i*j*k/n), in and out must not overlap
+    inline void backward(const TComplex* in, const TInt& istride, TComplex* out, TComplex* scratch) const {
+        work(out, in, 1, istride, &_factor[0], &_tw_bwd[0], scratch);
+    };
+};
+
+class FFT2D
+{
+private:
+    FFT _fft;
+
+    void transform(TComplex* data, TComplex* work, const bool& inverse) const;
+
+public:
+    FFT2D(const TInt& n = 0) : _fft(n) { };
+
+    //set the number of rows (and columns)
+    inline void resize(const TInt& n) { _fft.resize(n); };
+
+    //return the number of rows (and columns)
+    inline TInt row(void) const { return _fft.size(); };
+
+    //return the number of points == row() * row()
+    inline TInt size(void) const { return _fft.size() * _fft.size(); };
+
+    //return the number of TComplex needed by work
+    inline TInt work_size(void) const { return 2 * _fft.size() + _fft.scratch_size(); };
+
+    //in-place forward transform of data[row()*row()]
+    inline void forward(TComplex* data, TComplex* work) const { transform(data, work, false); };
+
+    //in-place backward transform, forward followed by backward multiplies data by size()
+    inline void backward(TComplex* data, TComplex* work) const { transform(data, work, true); };
+};
+
+#endif /* end of #ifndef FFT_H */
@@ -0,0 +1,372 @@
+//-------------------------------------------------
+//
+//          Laminar cortex model
+//
+// Developed by Jiaxin Du under the supervision of
+//    Prof. David Reutens and Dr. Viktor Vegh
+//
+//       Centre for Advanced Imaging (CAI),
+//   The University of Queensland (UQ), Australia
+//
+//        jiaxin.du@uqconnect.edu.au
+//
+// Reference:
+//  Du J, Vegh V, & Reutens DC,
+//                PLOS Compt Biol 8(10): e1002733.
+//              & NeuroImage 94: 1-11.
+//
+// See README for software copyright statements.
+//-------------------------------------------------
+#include "gather.h"
+
+#ifdef GATHER_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+//-------------------------------------------------------
+// scalar kernel, the terms of out[r] are added in the
+// order of the list, as the sparse engine always did
+//-------------------------------------------------------
+static void sum_none(const TReal* RESTRICT x, const TInt& stride, const TInt& nx,
+    const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    for (TInt r = 0; r < nx; ++r) out[r] = 0.;
+
+    for (TInt i = 0; i < n; ++i) {
+        for (TInt r = 0; r < nx; ++r) {
+            out[r] += w[i] * x[idx[i] + r * stride];
+        }
+    }
+}
+
+static void sum_none_sp(const TFloat* RESTRICT x, const TInt& stride, const TInt& nx,
+    const TInt* RESTRICT idx, const TFloat* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    TFloat acc;
+    for (TInt r = 0; r < nx; ++r) {
+        acc = 0.f;
+        for (TInt i = 0; i < n; ++i) {
+            acc += w[i] * x[idx[i] + r * stride];
+        }
+        out[r] = acc;
+    }
+}
+
+//the members of an ensemble are contiguous, see Gather::sum_ens()
+static void sum_ens_none(const TReal* RESTRICT x, const TInt& stride, const TInt& nx, const TInt& ne,
+    const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    for (TInt r = 0; r < nx; ++r) {
+        for (TInt m = 0; m < ne; ++m) out[r * ne + m] = 0.;
+
+        const TReal *xr = x + r * stride;
+        for (TInt i = 0; i < n; ++i) {
+            const TReal *xi = xr + idx[i] * ne;
+            for (TInt m = 0; m < ne; ++m) {
+                out[r * ne + m] += w[i] * xi[m];
+            }
+        }
+    }
+}
+
+#ifdef GATHER_X86_SIMD
+
+//-------------------------------------------------------
+// AVX2 kernel, 4 terms per step. NX arrays are summed in
+// one pass so that the indices and the weights are loaded once
+//-------------------------------------------------------
+template <int NX>
+__attribute__((target("avx2,fma")))
+static inline void sum_avx2_nx(const TReal* RESTRICT x, const TInt& stride,
+    const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    __m256d acc[NX];
+    for (int r = 0; r < NX; ++r) acc[r] = _mm256_setzero_pd();
+
+    TInt i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i vi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx + i));
+        __m256d vw = _mm256_loadu_pd(w + i);
+        for (int r = 0; r < NX; ++r) {
+            acc[r] = _mm256_fmadd_pd(vw, _mm256_i32gather_pd(x + r * stride, vi, 8), acc[r]);
+        }
+    }
+
+    for (int r = 0; r < NX; ++r) {
+        __m128d v = _mm_add_pd(_mm256_castpd256_pd128(acc[r]), _mm256_extractf128_pd(acc[r], 1));
+        TReal s = _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+        for (TInt j = i; j < n; ++j) {
+            s += w[j] * x[idx[j] + r * stride];
+        }
+        out[r] = s;
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void sum_avx2(const TReal* RESTRICT x, const TInt& stride, const TInt& nx,
+    const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    TInt r = 0;
+    for (; r + 2 <= nx; r += 2) {
+        sum_avx2_nx<2>(x + r * stride, stride, idx, w, n, out + r);
+    }
+    if (r < nx) {
+        sum_avx2_nx<1>(x + r * stride, stride, idx, w, n, out + r);
+    }
+}
+
+//-------------------------------------------------------
+// AVX-512F kernel, 8 terms per step, the last (partial)
+// step is done with a masked gather
+//-------------------------------------------------------
+template <int NX>
+__attribute__((target("avx512f")))
+static inline void sum_avx512_nx(const TReal* RESTRICT x, const TInt& stride,
+    const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    __m512d acc[NX];
+    for (int r = 0; r < NX; ++r) acc[r] = _mm512_setzero_pd();
+
+    TInt i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i vi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + i));
+        __m512d vw = _mm512_loadu_pd(w + i);
+        for (int r = 0; r < NX; ++r) {
+            acc[r] = _mm512_fmadd_pd(vw, _mm512_i32gather_pd(vi, x + r * stride, 8), acc[r]);
+        }
+    }
+
+    if (i < n) {
+        //the masked lanes are neither loaded nor gathered
+        __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1);
+        TInt tail[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        for (TInt j = i; j < n; ++j) tail[j - i] = idx[j];
+        __m256i vi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tail));
+        __m512d vw = _mm512_maskz_loadu_pd(mask, w + i);
+        for (int r = 0; r < NX; ++r) {
+            acc[r] = _mm512_fmadd_pd(vw, _mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, vi, x + r * stride, 8), acc[r]);
+        }
+    }
+
+    for (int r = 0; r < NX; ++r) {
+        out[r] = _mm512_reduce_add_pd(acc[r]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void sum_avx512(const TReal* RESTRICT x, const TInt& stride, const TInt& nx,
+    const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    TInt r = 0;
+    for (; r + 2 <= nx; r += 2) {
+        sum_avx512_nx<2>(x + r * stride, stride, idx, w, n, out + r);
+    }
+    if (r < nx) {
+        sum_avx512_nx<1>(x + r * stride, stride, idx, w, n, out + r);
+    }
+}
+
+//-------------------------------------------------------
+// single precision kernels, as above with twice the lanes
+//-------------------------------------------------------
+template <int NX>
+__attribute__((target("avx2,fma")))
+static inline void sum_avx2_sp_nx(const TFloat* RESTRICT x, const TInt& stride,
+    const TInt* RESTRICT idx, const TFloat* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    __m256 acc[NX];
+    for (int r = 0; r < NX; ++r) acc[r] = _mm256_setzero_ps();
+
+    TInt i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i vi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + i));
+        __m256 vw = _mm256_loadu_ps(w + i);
+        for (int r = 0; r < NX; ++r) {
+            acc[r] = _mm256_fmadd_ps(vw, _mm256_i32gather_ps(x + r * stride, vi, 4), acc[r]);
+        }
+    }
+
+    for (int r = 0; r < NX; ++r) {
+        __m128 v = _mm_add_ps(_mm256_castps256_ps128(acc[r]), _mm256_extractf128_ps(acc[r], 1));
+        v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        TFloat s = _mm_cvtss_f32(_mm_add_ss(v, _mm_movehdup_ps(v)));
+        for (TInt j = i; j < n; ++j) {
+            s += w[j] * x[idx[j] + r * stride];
+        }
+        out[r] = s;
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void sum_avx2_sp(const TFloat* RESTRICT x, const TInt& stride, const TInt& nx,
+    const TInt* RESTRICT idx, const TFloat* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    TInt r = 0;
+    for (; r + 2 <= nx; r += 2) {
+        sum_avx2_sp_nx<2>(x + r * stride, stride, idx, w, n, out + r);
+    }
+    if (r < nx) {
+        sum_avx2_sp_nx<1>(x + r * stride, stride, idx, w, n, out + r);
+    }
+}
+
+template <int NX>
+__attribute__((target("avx512f")))
+static inline void sum_avx512_sp_nx(const TFloat* RESTRICT x, const TInt& stride,
+    const TInt* RESTRICT idx, const TFloat* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    __m512 acc[NX];
+    for (int r = 0; r < NX; ++r) acc[r] = _mm512_setzero_ps();
+
+    TInt i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i vi = _mm512_loadu_si512(idx + i);
+        __m512 vw = _mm512_loadu_ps(w + i);
+        for (int r = 0; r < NX; ++r) {
+            acc[r] = _mm512_fmadd_ps(vw, _mm512_i32gather_ps(vi, x + r * stride, 4), acc[r]);
+        }
+    }
+
+    if (i < n) {
+        __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512i vi = _mm512_maskz_loadu_epi32(mask, idx + i);
+        __m512 vw = _mm512_maskz_loadu_ps(mask, w + i);
+        for (int r = 0; r < NX; ++r) {
+            acc[r] = _mm512_fmadd_ps(vw, _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, vi, x + r * stride, 4), acc[r]);
+        }
+    }
+
+    for (int r = 0; r < NX; ++r) {
+        out[r] = _mm512_reduce_add_ps(acc[r]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void sum_avx512_sp(const TFloat* RESTRICT x, const TInt& stride, const TInt& nx,
+    const TInt* RESTRICT idx, const TFloat* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    TInt r = 0;
+    for (; r + 2 <= nx; r += 2) {
+        sum_avx512_sp_nx<2>(x + r * stride, stride, idx, w, n, out + r);
+    }
+    if (r < nx) {
+        sum_avx512_sp_nx<1>(x + r * stride, stride, idx, w, n, out + r);
+    }
+}
+
+//-------------------------------------------------------
+// ensemble kernels, a tap is the weight broadcast times the
+// members of the element (4 or 8 per vector), the members
+// beyond the last whole vector are masked
+//-------------------------------------------------------
+__attribute__((target("avx2,fma")))
+static void sum_ens_avx2(const TReal* RESTRICT x, const TInt& stride, const TInt& nx, const TInt& ne,
+    const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    for (TInt r = 0; r < nx; ++r) {
+        const TReal *xr = x + r * stride;
+        for (TInt m = 0; m < ne; m += 4) {
+            __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(ne - m), _mm256_setr_epi64x(0, 1, 2, 3));
+            __m256d acc = _mm256_setzero_pd();
+            for (TInt i = 0; i < n; ++i) {
+                acc = _mm256_fmadd_pd(_mm256_broadcast_sd(w + i), _mm256_maskload_pd(xr + idx[i] * ne + m, mask), acc);
+            }
+            _mm256_maskstore_pd(out + r * ne + m, mask, acc);
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+static void sum_ens_avx512(const TReal* RESTRICT x, const TInt& stride, const TInt& nx, const TInt& ne,
+    const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out)
+{
+    for (TInt r = 0; r < nx; ++r) {
+        const TReal *xr = x + r * stride;
+        for (TInt m = 0; m < ne; m += 8) {
+            __mmask8 mask = static_cast<__mmask8>((ne - m >= 8) ? 0xff : (1u << (ne - m)) - 1);
+            __m512d acc = _mm512_setzero_pd();
+            for (TInt i = 0; i < n; ++i) {
+                acc = _mm512_fmadd_pd(_mm512_set1_pd(w[i]), _mm512_maskz_loadu_pd(mask, xr + idx[i] * ne + m), acc);
+            }
+            _mm512_mask_storeu_pd(out + r * ne + m, mask, acc);
+        }
+    }
+}
+
+#endif /* end of #ifdef GATHER_X86_SIMD */
+
+Gather::Gather(void) : _level(SIMD_NONE), _sum(sum_none), _sum_sp(sum_none_sp), _sum_ens(sum_ens_none)
+{  }
+
+bool Gather::supported(const TInt& level)
+{
+    switch (level) {
+    case SIMD_NONE:
+        return true;
+#ifdef GATHER_X86_SIMD
+    case SIMD_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case SIMD_AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+TInt Gather::widest(void)
+{
+    if (supported(SIMD_AVX512)) return SIMD_AVX512;
+    if (supported(SIMD_AVX2)) return SIMD_AVX2;
+    return SIMD_NONE;
+}
+
+const char* Gather::name(const TInt& level)
+{
+    switch (level) {
+    case SIMD_AUTO:
+        return "auto";
+    case SIMD_NONE:
+        return "scalar";
+    case SIMD_AVX2:
+        return "AVX2";
+    case SIMD_AVX512:
+        return "AVX-512";
+    default:
+        return "unknown";
+    }
+}
+
+bool Gather::set(const TInt& level)
+{
+    TInt lv = (level == SIMD_AUTO) ? widest() : level;
+
+    if (!supported(lv)) return false;
+
+    _level = lv;
+    switch (lv) {
+#ifdef GATHER_X86_SIMD
+    case SIMD_AVX2:
+        _sum = sum_avx2;
+        _sum_sp = sum_avx2_sp;
+        _sum_ens = sum_ens_avx2;
+        break;
+    case SIMD_AVX512:
+        _sum = sum_avx512;
+        _sum_sp = sum_avx512_sp;
+        _sum_ens = sum_ens_avx512;
+        break;
+#endif
+    default:
+        _sum = sum_none;
+        _sum_sp = sum_none_sp;
+        _sum_ens = sum_ens_none;
+        break;
+    }
+
+    return true;
+}
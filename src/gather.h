@@ -0,0 +1,131 @@
+//-------------------------------------------------
+//
+//          Laminar cortex model
+//
+// Developed by Jiaxin Du under the supervision of
+//    Prof. David Reutens and Dr. Viktor Vegh
+//
+//       Centre for Advanced Imaging (CAI),
+//   The University of Queensland (UQ), Australia
+//
+//        jiaxin.du@uqconnect.edu.au
+//
+// Reference:
+//  Du J, Vegh V, & Reutens DC,
+//                PLOS Compt Biol 8(10): e1002733.
+//              & NeuroImage 94: 1-11.
+//
+// See README for software copyright statements.
+//-------------------------------------------------
+#pragma once
+
+#ifndef GATHER_H
+#define GATHER_H
+
+//----------------------------------------
+//          Weighted gather
+//
+// Gather computes the weighted sums over a list of
+// indices for nx arrays that are stride apart, i.e.,
+//   out[r] = sum_i w[i] * x[idx[i] + r*stride],  r < nx
+// which is the inner loop of the sparse engine (x is a
+// PSP plane, r is the receptor, idx/w is a delay bucket)
+//
+// The kernel is selected at runtime:
+//   SIMD_NONE:   scalar, the terms are added in order
+//   SIMD_AVX2:   4 lanes with AVX2 gathers and FMA
+//   SIMD_AVX512: 8 lanes with AVX-512F gathers and FMA,
+//                the tail is handled with masks
+// The vector kernels add the terms in another order, so
+// the results differ by rounding from SIMD_NONE
+//
+// The same kernels are provided for TFloat x and w (the 
+// sum is accumulated in TFloat), with 8 (AVX2) and 16 
+// (AVX-512) lanes
+//
+// sum_ens() is the gather of an ensemble (see SIMU.ENSEMBLE),
+// where x holds ne members of every element side by side:
+//   out[r*ne + m] = sum_i w[i] * x[idx[i]*ne + m + r*stride]
+// A tap is one weight times a contiguous load of the members,
+// so the vector kernels run one FMA per tap for 4 (AVX2) or 8
+// (AVX-512) members, and every member is summed in the order
+// of the list (the scalar kernel gives the results of sum())
+//
+// The SIMD kernels are only compiled for x86 with GCC-
+// compatible compilers (target attributes), other builds
+// support SIMD_NONE only
+//----------------------------------------
+
+#include "misc.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define GATHER_X86_SIMD
+#endif
+
+#ifndef SIMD_ENUM
+#define SIMD_ENUM
+enum SimdLevel {
+    SIMD_AUTO = -1, //the widest supported by the processor
+    SIMD_NONE = 0,
+    SIMD_AVX2 = 1,
+    SIMD_AVX512 = 2
+};
+#endif
+
+class Gather
+{
+public:
+    typedef void(*TSumFunc)(const TReal* RESTRICT x, const TInt& stride, const TInt& nx,
+        const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out);
+
+    typedef void(*TSumFuncSp)(const TFloat* RESTRICT x, const TInt& stride, const TInt& nx,
+        const TInt* RESTRICT idx, const TFloat* RESTRICT w, const TInt& n, TReal* RESTRICT out);
+
+    typedef void(*TSumEnsFunc)(const TReal* RESTRICT x, const TInt& stride, const TInt& nx, const TInt& ne,
+        const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out);
+
+private:
+    TInt        _level;
+    TSumFunc    _sum;
+    TSumFuncSp  _sum_sp;
+    TSumEnsFunc _sum_ens;
+
+public:
+    //the scalar kernel is used until set() is called
+    Gather(void);
+
+    //return whether the processor (and the build) supports the level
+    static bool supported(const TInt& level);
+
+    //return the widest supported level
+    static TInt widest(void);
+
+    //return the name of the level
+    static const char* name(const TInt& level);
+
+    //select the kernel, SIMD_AUTO selects widest()
+    //return false if the level is not supported
+    bool set(const TInt& level);
+
+    inline TInt level(void) const { return _level; };
+
+    //out[r] = sum_{i<n} w[i] * x[idx[i] + r*stride] for r < nx
+    inline void sum(const TReal* RESTRICT x, const TInt& stride, const TInt& nx,
+        const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out) const {
+        _sum(x, stride, nx, idx, w, n, out);
+    };
+
+    //the same in single precision
+    inline void sum(const TFloat* RESTRICT x, const TInt& stride, const TInt& nx,
+        const TInt* RESTRICT idx, const TFloat* RESTRICT w, const TInt& n, TReal* RESTRICT out) const {
+        _sum_sp(x, stride, nx, idx, w, n, out);
+    };
+
+    //out[r*ne + m] = sum_{i<n} w[i] * x[idx[i]*ne + m + r*stride] for r < nx, m < ne
+    inline void sum_ens(const TReal* RESTRICT x, const TInt& stride, const TInt& nx, const TInt& ne,
+        const TInt* RESTRICT idx, const TReal* RESTRICT w, const TInt& n, TReal* RESTRICT out) const {
+        _sum_ens(x, stride, nx, ne, idx, w, n, out);
+    };
+};
+
+#endif /* end of #ifndef GATHER_H */
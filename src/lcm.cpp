@@ -21,17 +21,24 @@
 
 using namespace std;
 
+//order the entries of a connection list by spike delay, see LCM::init()
+static bool conn_delay_less(const pair<TInt, pair<TInt, TReal> >& a, const pair<TInt, pair<TInt, TReal> >& b)
+{
+    return a.first < b.first;
+}
+
 //LCM global parameter
-const char *LCM::LCM_paramName[] = { "SIZE", "SIDE_GRID", "TIME_STEP", "SIMU_TIME" };
-const TReal LCM::LCM_paramMin[] = { 0,           2,           0,           0 };
-const TReal LCM::LCM_paramMax[] = { 1000,         100,          10,     1000000 };
+const char *LCM::LCM_paramName[] = { "SIZE", "SIDE_GRID", "TIME_STEP", "SIMU_TIME", "SYNP_JITTER", "SYNP_STORE", "FIRE_TOL" };
+const TReal LCM::LCM_paramMin[] = { 0,           2,           0,           0,             0,            0,          0 };
+const TReal LCM::LCM_paramMax[] = { 1000,         100,          10,     1000000,             1,            1,       1e-2 };
 
 //--------------------------------------------------
 // function: LCM::LCM
 //   default constructor
 //--------------------------------------------------
 LCM::LCM() :
-    gSpk_delay(NULL), gSynp_pct(NULL), gElmt_num(0), gNG_num(0), gGrid_row(0),
+    gSpk_delay(NULL), gSynp_kern(NULL), gSynp_jitter(0.2),
+    gSynp_store(SYNP_STORE_TABLE), gSynp_seed(0), gFire_tol(0), gBlock_max(1), gElmt_num(0), gNG_num(0), gGrid_row(0),
     gROI_size(0), gTotal_time(0), gStep_size(0), gElmt_size(0), gInv_step(0),
     gLayer_num(0), gRcpt_type(0), gStim_num(0), _l_state(false),
     _l_neur_state(false), _l_layer_state(false), _l_exsrc_state(false)
@@ -40,6 +47,11 @@ LCM::LCM() :
         _lcm_paramFlg[ii] = false;
     }
 
+    //optional parameters
+    _lcm_paramFlg[LCM_IDX_SYNP_JITTER] = true;
+    _lcm_paramFlg[LCM_IDX_SYNP_STORE] = true;
+    _lcm_paramFlg[LCM_IDX_FIRE_TOL] = true;
+
     //the following strings cannot be used as object name
     gObj_name_lst.insert("GLOBAL");
     gObj_name_lst.insert("LAYER");
@@ -63,11 +75,11 @@ LCM::~LCM(void)
         delete[] gSpk_delay;
     }
 
-    if (gSynp_pct != NULL) {
+    if (gSynp_kern != NULL) {
         for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
-            delete[] gSynp_pct[ineur];
+            delete[] gSynp_kern[ineur];
         }
-        delete[] gSynp_pct;
+        delete[] gSynp_kern;
     }
 }
 
@@ -380,6 +392,21 @@ bool LCM::set_simu_param(string paramName, string paramVal)
             gTotal_step = static_cast<TInt>(gTotal_time / gStep_size);
         return true;
 
+    case (LCM_IDX_SYNP_JITTER):
+        gSynp_jitter = val;
+        _lcm_paramFlg[LCM_IDX_SYNP_JITTER] = true;
+        return true;
+
+    case (LCM_IDX_SYNP_STORE):
+        gSynp_store = static_cast<TInt>(val + 0.5);
+        _lcm_paramFlg[LCM_IDX_SYNP_STORE] = true;
+        return true;
+
+    case (LCM_IDX_FIRE_TOL):
+        gFire_tol = val;
+        _lcm_paramFlg[LCM_IDX_FIRE_TOL] = true;
+        return true;
+
     default:
         return false;
     }
@@ -1098,6 +1125,16 @@ bool LCM::init(void)
         if (it->V_rev() < gV_rev_min)  gV_rev_min = it->V_rev();
     }
 
+    //the membrane potentials are kept in [gV_rev_min, gV_rev_max]
+    for (vector<NeurGrp>::iterator it = gNeur.begin(); it != gNeur.end(); ++it) {
+        if (!it->set_fire_table(gV_rev_min, gV_rev_max, gFire_tol)) {
+            cerr << "ERROR! LCM::init: LCM.FIRE_TOL = " << gFire_tol << " needs a firing table of more than "
+                << FIRE_TABLE_MAX << " intervals for " << it->name() << ". " << _FILE_LINE_ << endl;
+            _l_state = false;
+            return false;
+        }
+    }
+
     //----------------------------------------------
     //add stimulator to their external sources
     //----------------------------------------------
@@ -1213,105 +1250,244 @@ bool LCM::init(void)
         }
         delete[] gSpk_delay;
     }
-
     gSpk_delay = new TInt*[gNeur.size()];
 
-    if (gSynp_pct != NULL) {
+    if (gSynp_kern != NULL) {
         for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
-            delete[] gSynp_pct[ineur];
+            delete[] gSynp_kern[ineur];
         }
-        delete[] gSynp_pct;
+        delete[] gSynp_kern;
     }
-    gSynp_pct = new TReal*[gNeur.size()];
+    gSynp_kern = new TReal*[gNeur.size()];
 
     TInt spk_delay_size = gGrid_row * gGrid_row * SPK_PATH_NUM;
-    TInt synp_pct_size = gElmt_num * gElmt_num * SPK_PATH_NUM;
 
+    //spike delay and synapse ratio (without jitter) over every displacement
+    //ipath==1 and ipath==3 go over the horizontal boundary, 
+    //ipath==2 and ipath==3 go over the vertical boundary, see SPK_DELAY_IDX
     for (TInt ineur = 0; ineur < gNeur.size(); ++ineur) {
         gSpk_delay[ineur] = new TInt[spk_delay_size];
-        std::fill(gSpk_delay[ineur], gSpk_delay[ineur] + spk_delay_size, MAX_INT_NUM);
-
-        gSynp_pct[ineur] = new TReal[synp_pct_size];
-
-        TInt d_x, d_y;
-        TReal tmp;
-
-        TInt *spk_delay;
-        TReal *synp_pct;
-        for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
-            for (TInt jelmt = 0; jelmt < gElmt_num; ++jelmt) {
+        gSynp_kern[ineur] = new TReal[spk_delay_size];
 
-                d_x = abs(ielmt / gGrid_row - jelmt / gGrid_row);
-                d_y = abs(ielmt%gGrid_row - jelmt%gGrid_row);
+        TInt p_x, p_y;
+        for (TInt d_x = 0; d_x < gGrid_row; ++d_x) {
+            for (TInt d_y = 0; d_y < gGrid_row; ++d_y) {
+                for (TInt ipath = 0; ipath < SPK_PATH_NUM; ++ipath) {
+                    p_x = (ipath & 1) ? gGrid_row - d_x : d_x;
+                    p_y = (ipath & 2) ? gGrid_row - d_y : d_y;
 
-                //path 1
-                spk_delay = gSpk_delay[ineur] + SPK_DELAY_IDX(d_x, d_y, 0);
-                synp_pct = gSynp_pct[ineur] + SYNP_PCT_IDX(ielmt, jelmt, 0);
-
-                if ((*spk_delay) == MAX_INT_NUM)
-                    (*spk_delay) = static_cast<TInt>(sqrt(1.0*d_x*d_x + d_y*d_y)
+                    gSpk_delay[ineur][SPK_DELAY_IDX(d_x, d_y, ipath)] = static_cast<TInt>(sqrt(1.0*p_x*p_x + p_y*p_y)
                         * gElmt_size / (gNeur[ineur].spk_speed() * gStep_size) + 0.5);
-                do {
-                    tmp = rand_gauss(1., 0.2);
-                } while (tmp < 0.);
+                    gSynp_kern[ineur][SPK_DELAY_IDX(d_x, d_y, ipath)] = 
+                        gNeur[ineur].eqn_synp_ratio(p_x*gElmt_size, p_y*gElmt_size, gElmt_size);
+                }
+            }
+        }
+    }
 
-                (*synp_pct) = tmp * gNeur[ineur].eqn_synp_ratio(d_x*gElmt_size, d_y*gElmt_size, gElmt_size);
+    gConn_ptr.clear();
+    gConn_src.clear();
+    gConn_pct.clear();
+    gBkt_bgn.clear();
+    gBkt_delay.clear();
+
+    gStcl_ptr.clear();
+    gStcl_off.clear();
+    gStcl_delay.clear();
+    gStcl_kern.clear();
+
+    //the shortest delay of a pathway between two different elements, for gBlock_max
+    vector<TInt> xelmt_delay(gNG_num, MAX_INT_NUM);
+
+    //the longest delay of a kept pathway, see conn_delay_max()
+    gDelay_max.assign(gNG_num, 0);
+
+    if (gSynp_store == SYNP_STORE_TABLE) {
+        //---------------------------------------------
+        //every pathway between two elements gets its own jitter
+        //---------------------------------------------
+        //the pathways are visited in the order their jitter is drawn, i.e., 
+        //source element by source element, and each kept pathway is appended
+        //to the row of its target element, so no table of size gElmt_num^2 
+        //is needed and only the entries above SYNP_RATIO_EPS are held.
+        //the Gaussian synapse distribution is effectively zero beyond a few
+        //SYNP_SIGMA, so only the non-zero pathways are kept for the simulation.
+        //the displacement (d_x, d_y) is taken in the same order as it is used
+        //to fill gSpk_delay above, i.e., d_x along the rows of the grid, so that
+        //the synapse ratio and the delay of an entry belong to the same pathway
+        //the entries of a row are sorted by spike delay (stable, so the entries
+        //of a bucket stay in the order of source element and pathway)
+        gConn_ptr.assign(gNG_num * gElmt_num + 1, 0);
+        gBkt_bgn.assign(1, 0);
+
+        vector<vector<pair<TInt, pair<TInt, TReal> > > > row(gElmt_num); //[t_elmt](delay, (source, ratio))
+        for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+            TInt d_x, d_y, idx;
+            TReal tmp;
+
+            for (TInt s_elmt = 0; s_elmt < gElmt_num; ++s_elmt) {
+                for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) {
+                    d_x = abs(s_elmt / gGrid_row - t_elmt / gGrid_row);
+                    d_y = abs(s_elmt % gGrid_row - t_elmt % gGrid_row);
+
+                    for (TInt ipath = 0; ipath < SPK_PATH_NUM; ++ipath) {
+                        //every pathway between two elements gets its own jitter
+                        tmp = 1.;
+                        if (gSynp_jitter > 0.) {
+                            do {
+                                tmp = rand_gauss(1., gSynp_jitter);
+                            } while (tmp < 0.);
+                        }
+
+                        idx = SPK_DELAY_IDX(d_x, d_y, ipath);
+                        tmp *= gSynp_kern[ineur][idx];
+
+                        if (tmp > SYNP_RATIO_EPS) {
+                            row[t_elmt].push_back(make_pair(gSpk_delay[ineur][idx], make_pair(s_elmt, tmp)));
+                            if (s_elmt != t_elmt)
+                                xelmt_delay[ineur] = std::min(xelmt_delay[ineur], gSpk_delay[ineur][idx]);
+                            gDelay_max[ineur] = std::max(gDelay_max[ineur], gSpk_delay[ineur][idx]);
+                        }
+                    }
+                }
+            }
 
-                if ((*synp_pct) < SYNP_RATIO_EPS)
-                    (*synp_pct) = 0.;
+            for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) {
+                std::stable_sort(row[t_elmt].begin(), row[t_elmt].end(), conn_delay_less);
+
+                for (vector<pair<TInt, pair<TInt, TReal> > >::const_iterator it = row[t_elmt].begin(); it != row[t_elmt].end(); ++it) {
+                    if (it == row[t_elmt].begin() || it->first != (it - 1)->first) {
+                        gBkt_delay.push_back(it->first);
+                        gBkt_bgn.push_back(0);
+                    }
+                    gConn_src.push_back(it->second.first);
+                    gConn_pct.push_back(it->second.second);
+                    gBkt_bgn.back() = gConn_src.size();
+                }
+                gConn_ptr[CONN_ROW_IDX(ineur, t_elmt) + 1] = gBkt_delay.size();
 
-                //path 2
-                ++spk_delay;
-                ++synp_pct;
+                vector<pair<TInt, pair<TInt, TReal> > >().swap(row[t_elmt]);
+            }
+        }
+    }
+    else {
+        //---------------------------------------------
+        //build the translation-invariant stencils
+        //---------------------------------------------
+        //the jitter of a pathway is regenerated from a hash of 
+        //(seed, neuron group, source, target, pathway) whenever it is needed,
+        //see LCM::synp_jitter(), so nothing of size gElmt_num^2 is stored.
+        //a pathway is dropped if it can not reach SYNP_RATIO_EPS
+        //even with the largest jitter Rand::hash_gauss() can produce
+        gSynp_seed = Rand::hash(rand_seed());
 
-                if ((*spk_delay) == MAX_INT_NUM)
-                    (*spk_delay) = static_cast<TInt>(sqrt(1.0*(gGrid_row - d_x)*(gGrid_row - d_x) + d_y*d_y)
-                        * gElmt_size / (gNeur[ineur].spk_speed() * gStep_size) + 0.5);
+        const TReal jit_max = 1. + HASH_GAUSS_MAX * gSynp_jitter;
 
-                do {
-                    tmp = rand_gauss(1., 0.2);
-                } while (tmp < 0.);
+        gStcl_ptr.assign(gNG_num + 1, 0);
 
-                (*synp_pct) = tmp * gNeur[ineur].eqn_synp_ratio((gGrid_row - d_x)*gElmt_size, d_y*gElmt_size, gElmt_size);
+        vector<pair<TInt, pair<TInt, TReal> > > stcl; //(delay, (offset, ratio))
+        for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+            TInt d_x, d_y, idx;
+            stcl.clear();
+            for (TInt u = -gGrid_row; u < gGrid_row; ++u) {
+                for (TInt v = -gGrid_row; v < gGrid_row; ++v) {
+                    //(u, v) is the pathway of the displacement ((u + G) % G, (v + G) % G),
+                    //which goes over the horizontal (vertical) boundary if u < 0 (v < 0)
+                    d_x = (u + gGrid_row) % gGrid_row;
+                    d_y = (v + gGrid_row) % gGrid_row;
+                    idx = SPK_DELAY_IDX(d_x, d_y, (u < 0) + 2 * (v < 0));
+                    if (gSynp_kern[ineur][idx] * jit_max > SYNP_RATIO_EPS) {
+                        stcl.push_back(make_pair(gSpk_delay[ineur][idx], make_pair(STCL_OFF(u, v), gSynp_kern[ineur][idx])));
+                        if (d_x != 0 || d_y != 0)
+                            xelmt_delay[ineur] = std::min(xelmt_delay[ineur], gSpk_delay[ineur][idx]);
+                        gDelay_max[ineur] = std::max(gDelay_max[ineur], gSpk_delay[ineur][idx]);
+                    }
+                }
+            }
 
-                if ((*synp_pct) < SYNP_RATIO_EPS)
-                    (*synp_pct) = 0.;
+            std::stable_sort(stcl.begin(), stcl.end(), conn_delay_less);
 
-                //path_3
-                ++spk_delay;
-                ++synp_pct;
-                if (*spk_delay == MAX_INT_NUM)
-                    (*spk_delay) = static_cast<TInt>(sqrt(1.0*d_x*d_x + (gGrid_row - d_y)*(gGrid_row - d_y))
-                        * gElmt_size / (gNeur[ineur].spk_speed() * gStep_size) + 0.5);
-                do {
-                    tmp = rand_gauss(1., 0.2);
-                } while (tmp < 0.);
-                (*synp_pct) = tmp * gNeur[ineur].eqn_synp_ratio(d_x*gElmt_size, (gGrid_row - d_y)*gElmt_size, gElmt_size);
-                if ((*synp_pct) < SYNP_RATIO_EPS)
-                    (*synp_pct) = 0.;
-
-                //path_4
-                ++spk_delay;
-                ++synp_pct;
-                if ((*spk_delay) == MAX_INT_NUM)
-                    (*spk_delay) = static_cast<TInt>(sqrt(1.0*(gGrid_row - d_x)*(gGrid_row - d_x) + (gGrid_row - d_y)*(gGrid_row - d_y))
-                        * gElmt_size / (gNeur[ineur].spk_speed() * gStep_size) + 0.5);
-                do {
-                    tmp = rand_gauss(1., 0.2);
-                } while (tmp < 0.);
-                (*synp_pct) = tmp * gNeur[ineur].eqn_synp_ratio((gGrid_row - d_x)*gElmt_size, (gGrid_row - d_y)*gElmt_size, gElmt_size);
-                if ((*synp_pct) < SYNP_RATIO_EPS)
-                    (*synp_pct) = 0.;
+            for (vector<pair<TInt, pair<TInt, TReal> > >::const_iterator it = stcl.begin(); it != stcl.end(); ++it) {
+                gStcl_off.push_back(it->second.first);
+                gStcl_delay.push_back(it->first);
+                gStcl_kern.push_back(it->second.second);
             }
+            gStcl_ptr[ineur + 1] = gStcl_off.size();
         }
     }
 
+    //---------------------------------------------
+    //the number of steps the elements can be advanced independently,
+    //a spike of another element arrives at the earliest after the 
+    //spike delay of a synapse plus the delay of the pathway
+    //---------------------------------------------
+    gBlock_max = BLOCK_STEP_MAX;
+    for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+        if (gNeur[ineur].synp_conn().empty() || xelmt_delay[ineur] == MAX_INT_NUM) continue;
+
+        TInt min_spk_delay = MAX_INT_NUM;
+        for (vector<SynpConn>::const_iterator sy_it = gNeur[ineur].synp_conn().begin(); sy_it != gNeur[ineur].synp_conn().end(); ++sy_it) {
+            min_spk_delay = std::min(min_spk_delay, sy_it->spk_delay());
+        }
+        gBlock_max = std::min(gBlock_max, min_spk_delay + xelmt_delay[ineur]);
+    }
+    gBlock_max = std::max(gBlock_max, 1);
+
     _l_state = true;
 
     //cout<<"LCM initialization finished! "<<endl;
     return true;
 }
 
+//-------------------------------------------------------
+// function: TInt LCM::conn_row(const TInt& ineur, const TInt& t_elmt, TInt *src, 
+//                              TReal *pct, TInt *bkt_bgn, TInt *bkt_delay) const
+//   Regenerate the connections projecting from neuron group ineur to 
+//   the target element t_elmt with SYNP_STORE_KERNEL, the entries are 
+//   written in the same form as a row of the sparse connection list,
+//   i.e., bucket ibkt holds src[bkt_bgn[ibkt]] .. src[bkt_bgn[ibkt+1]-1]
+//
+//   The arrays must hold at least conn_row_max() entries (plus one for bkt_bgn)
+//   Return the number of buckets
+//-------------------------------------------------------
+TInt LCM::conn_row(const TInt& ineur, const TInt& t_elmt, TInt *src, TReal *pct, TInt *bkt_bgn, TInt *bkt_delay) const
+{
+    assert(gSynp_store == SYNP_STORE_KERNEL);
+
+    const TInt n_uv = 2 * gGrid_row;
+
+    TInt t_x = t_elmt / gGrid_row;
+    TInt t_y = t_elmt % gGrid_row;
+
+    TInt u, v, s_x, s_y;
+    TInt num = 0;
+    TInt bkt_num = 0;
+    TReal val;
+
+    bkt_bgn[0] = 0;
+    for (TInt istcl = gStcl_ptr[ineur]; istcl < gStcl_ptr[ineur + 1]; ++istcl) {
+        u = gStcl_off[istcl] / n_uv - gGrid_row;
+        v = gStcl_off[istcl] % n_uv - gGrid_row;
+
+        s_x = (t_x + u + n_uv) % gGrid_row;
+        s_y = (t_y + v + n_uv) % gGrid_row;
+
+        val = gStcl_kern[istcl] * synp_jitter(ineur, s_y + gGrid_row * s_x, t_elmt, (u < 0) + 2 * (v < 0));
+        if (val > SYNP_RATIO_EPS) {
+            if (bkt_num == 0 || gStcl_delay[istcl] != bkt_delay[bkt_num - 1]) {
+                bkt_delay[bkt_num] = gStcl_delay[istcl];
+                ++bkt_num;
+            }
+            src[num] = s_y + gGrid_row * s_x;
+            pct[num] = val;
+            ++num;
+            bkt_bgn[bkt_num] = num;
+        }
+    }
+
+    return bkt_num;
+}
+
 //-----------------------------------------------
 // function: string LCM::print(void)
 //   Return the parameter setting of the model
@@ -1331,6 +1507,9 @@ string LCM::print(void) const
     oss << "\t" << LCM_paramName[LCM_IDX_GRID_ROW] << " = " << gGrid_row << ";" << endl;
     oss << "\t" << LCM_paramName[LCM_IDX_SIMU_TIME] << " = " << gTotal_time << "; // msec" << endl;
     oss << "\t" << LCM_paramName[LCM_IDX_TIME_STEP] << " = " << gStep_size << "; // msec" << endl;
+    oss << "\t" << LCM_paramName[LCM_IDX_SYNP_JITTER] << " = " << gSynp_jitter << ";" << endl;
+    oss << "\t" << LCM_paramName[LCM_IDX_SYNP_STORE] << " = " << gSynp_store << ";" << endl;
+    oss << "\t" << LCM_paramName[LCM_IDX_FIRE_TOL] << " = " << gFire_tol << ";" << endl;
     oss << "};" << endl << endl;
 
     oss << "//" << endl;
@@ -36,6 +36,7 @@
 //--------------------------------------------------
 
 #include "misc.h"
+#include "array.h"
 #include "rand.h"
 #include "layer.h"
 #include "neurgrp.h"
@@ -45,13 +46,26 @@
 #include "stimulator.h"
 #include <map>
 #include <set>
+#include <algorithm>
 
 #ifndef LCM_PARA_NUM
-#define LCM_PARA_NUM       4
+#define LCM_PARA_NUM       7
 #define LCM_IDX_GRID_SIZE  0
 #define LCM_IDX_GRID_ROW   1
 #define LCM_IDX_TIME_STEP  2
 #define LCM_IDX_SIMU_TIME  3
+#define LCM_IDX_SYNP_JITTER 4
+#define LCM_IDX_SYNP_STORE  5
+#define LCM_IDX_FIRE_TOL    6
+#endif
+
+//how the synapse ratios between elements are stored
+#ifndef SYNP_STORE_MODE
+#define SYNP_STORE_MODE
+enum SynpStore {
+    SYNP_STORE_TABLE = 0,  //one jittered ratio per element pair, O(gElmt_num^2) memory
+    SYNP_STORE_KERNEL = 1  //one ratio per displacement, jitter regenerated by hashing, O(gElmt_num) memory
+};
 #endif
 
 class LCM {
@@ -72,12 +86,54 @@ protected:
    //ipath==3: dx = gGrid_row - |x1 - x2| and dy = gGrid_row - |y1-y2|; //go over both boundary
 #endif
 
-   //the ratio of synapses formed between two groups at a distance 
-    TReal     **gSynp_pct;  //[n1][n2], n1==gNG_num, n2==gElmt_num * gElmt_num * SPK_PATH_NUM
-#ifndef SYNP_PCT_IDX
-#define SYNP_PCT_IDX(ix, iy, ipath) (ipath + SPK_PATH_NUM*(iy + gElmt_num*ix))
-   //the same as SPK_DELAY_IDX, except gSynp_pct is dependent on the number of the elements
-   //not just the displacement betweent them
+   //sparse (CSR) connection list, only the pathways with a synapse ratio
+   //above SYNP_RATIO_EPS are kept. Row CONN_ROW_IDX(ineur, t_elmt) holds the
+   //entries projecting from neuron group ineur to the target element t_elmt, 
+   //sorted by spike delay and grouped into the buckets gConn_ptr[row] .. gConn_ptr[row+1]-1.
+   //Bucket ibkt holds the entries gBkt_bgn[ibkt] .. gBkt_bgn[ibkt+1]-1, which share 
+   //the spike delay gBkt_delay[ibkt], so the PSP history is indexed once per bucket.
+   //The pages are placed by the threads reading the rows, see Simulation::place_conn()
+    std::vector<TInt, TouchAllocator<TInt> >  gConn_ptr;   //[gNG_num * gElmt_num + 1]
+    std::vector<TInt, TouchAllocator<TInt> >  gConn_src;   //source element of an entry
+    std::vector<TReal, TouchAllocator<TReal> > gConn_pct;   //synapse ratio of an entry
+    std::vector<TInt, TouchAllocator<TInt> >  gBkt_bgn;    //[bucket number + 1]
+    std::vector<TInt, TouchAllocator<TInt> >  gBkt_delay;  //spike delay (in steps) of a bucket
+#ifndef CONN_ROW_IDX
+#define CONN_ROW_IDX(ineur, ielmt) ((ielmt) + gElmt_num*(ineur))
+#endif
+
+   //the ratio of synapses formed over a displacement without jitter,
+   //indexed in the same way as gSpk_delay, i.e., SPK_DELAY_IDX(dx, dy, ipath)
+    TReal     **gSynp_kern; //[n1][n2], n1==gNG_num, n2==gGrid_row * gGrid_row * SPK_PATH_NUM
+
+   //translation-invariant stencil used with SYNP_STORE_KERNEL, the pathways 
+   //gStcl_off[gStcl_ptr[ineur]] .. gStcl_off[gStcl_ptr[ineur+1]-1] are the only ones 
+   //of which the ratio can reach SYNP_RATIO_EPS, whatever the jitter. A pathway is given 
+   //by the signed offsets (u, v), -gGrid_row <= u, v < gGrid_row, going from the target
+   //to the source, and the pathways of a group are sorted by spike delay
+    std::vector<TInt>        gStcl_ptr;   //[gNG_num + 1]
+    std::vector<TInt>        gStcl_off;   //== STCL_OFF(u, v)
+    std::vector<TInt>        gStcl_delay; //spike delay of a pathway
+    std::vector<TReal>       gStcl_kern;  //synapse ratio of a pathway without jitter
+#ifndef STCL_OFF
+#define STCL_OFF(u, v) (((v) + gGrid_row) + 2*gGrid_row*((u) + gGrid_row))
+#endif
+
+    TReal    gSynp_jitter; // standard deviation of the jitter on synapse ratios
+    TInt     gSynp_store;  // SYNP_STORE_TABLE or SYNP_STORE_KERNEL
+    unsigned long long gSynp_seed; // key of the hashed jitter
+    TReal    gFire_tol;    // error of the tables of the firing functions (relative), 0 for none
+
+   //the number of steps an element can be advanced before the spikes of the other 
+   //elements in these steps arrive, i.e., the shortest synaptic spike delay plus the 
+   //shortest delay of a kept pathway between two different elements, see LCM::init()
+    TInt     gBlock_max;
+
+   //[ineur], the longest delay of a kept pathway of a group (the connection list or the 
+   //stencils), which bounds the PSP history the synapses of the group read, see LCM::init()
+    std::vector<TInt> gDelay_max;
+#ifndef BLOCK_STEP_MAX
+#define BLOCK_STEP_MAX 32
 #endif
 
    //LCM structure memebers
@@ -251,6 +307,42 @@ public:
     //return the number of external sources in the model
     inline TInt exsrc_num(void) const { return gExSrc_num; };
 
+    //return the number of entries in the sparse connection list
+    inline TInt conn_num(void) const { return gConn_src.size(); };
+
+    //return the number of delay buckets in the sparse connection list
+    inline TInt bkt_num(void) const { return gBkt_delay.size(); };
+
+    //return how the synapse ratios are stored, SYNP_STORE_TABLE or SYNP_STORE_KERNEL
+    inline TInt synp_store(void) const { return gSynp_store; };
+
+    //return the largest error of the tables of the firing functions relative to 
+    //FIRE_MAX, 0 if the firing functions are calculated exactly, see NeurGrp::set_fire_table()
+    inline TReal fire_tol(void) const { return gFire_tol; };
+
+    //return the standard deviation of the jitter on the synapse ratios
+    inline TReal synp_jitter_sd(void) const { return gSynp_jitter; };
+
+    //return the number of pathways in the stencils of all neuron groups
+    inline TInt stcl_num(void) const { return gStcl_off.size(); };
+
+    //return the number of steps the elements can be advanced independently (at least 1)
+    inline TInt block_step_max(void) const { return gBlock_max; };
+
+    //return the longest delay (in steps) of a kept pathway from the neuron group ineur
+    inline TInt conn_delay_max(const TInt& ineur) const { return gDelay_max[ineur]; };
+
+    //return the maximum number of entries (and buckets) conn_row() can write 
+    inline TInt conn_row_max(void) const;
+
+    //return the jitter factor of the synapse ratio of a pathway (used by SYNP_STORE_KERNEL)
+    inline TReal synp_jitter(const TInt& ineur, const TInt& s_elmt, const TInt& t_elmt, const TInt& ipath) const;
+
+    //regenerate the connections projecting from neuron group ineur to element t_elmt 
+    //from the stencil, in the same form as a row of the sparse connection list,
+    //return the number of buckets written to bkt_bgn and bkt_delay
+    TInt conn_row(const TInt& ineur, const TInt& t_elmt, TInt *src, TReal *pct, TInt *bkt_bgn, TInt *bkt_delay) const;
+
     //return the number of external stimulators in the model
     inline TInt stim_num(void) const { return gStim_num; };
 
@@ -263,6 +355,14 @@ public:
     //return the minimum voltage neurons can achieve == minimum V_rev of among neuron groups
     inline TReal min_volt(void) const { return gV_rev_min; };
 
+    //return the number of the excitatory and the inhibitory receptors
+    inline TInt rcpt_excit_num(void) const { return gRcpt_excit.size(); };
+    inline TInt rcpt_inhib_num(void) const { return gRcpt_inhib.size(); };
+
+    //return the receptors of the excitatory and the inhibitory sources by their order in the step
+    inline const Receptor& rcpt_excit(const TInt& idx) const { return gRcpt_excit[idx]; };
+    inline const Receptor& rcpt_inhib(const TInt& idx) const { return gRcpt_inhib[idx]; };
+
     //return the name of objects
     //returnt the name of a neuron group
     inline std::string neur_name(const TInt& idx) const { return gNeur[idx].name(); };
@@ -342,4 +442,30 @@ public:
 
 };
 
+inline TInt LCM::conn_row_max(void) const
+{
+    TInt n = 0;
+    for (TInt ineur = 0; ineur + 1 < static_cast<TInt>(gStcl_ptr.size()); ++ineur) {
+        n = std::max(n, gStcl_ptr[ineur + 1] - gStcl_ptr[ineur]);
+    }
+    return n;
+}
+
+inline TReal LCM::synp_jitter(const TInt& ineur, const TInt& s_elmt, const TInt& t_elmt, const TInt& ipath) const
+{
+    if (gSynp_jitter == 0.) return 1.;
+
+    //element indices are less than power(2, 20), see LCM_paramMax
+    unsigned long long key = gSynp_seed ^ ((static_cast<unsigned long long>(ipath + SPK_PATH_NUM*ineur) << 40)
+        | (static_cast<unsigned long long>(s_elmt) << 20) | static_cast<unsigned long long>(t_elmt));
+
+    TReal tmp;
+    do {
+        tmp = Rand::hash_gauss(key, 1., gSynp_jitter);
+        key = Rand::hash(key);
+    } while (tmp < 0.);
+
+    return tmp;
+}
+
 #endif /* end of #ifndef LCM_H */
@@ -41,7 +41,11 @@ NeurGrp::NeurGrp(const string& xname, const TInt& idx) :
     _ng_layer(-1),
     _ng_type(cNaN),
     _ng_paramFlg(NG_PARA_NUM, false),
-    _ng_state(false)
+    _ng_state(false),
+    _ng_fire_vmin(0),
+    _ng_fire_inv(0),
+    _ng_fire_xmax(0),
+    _ng_fire_err(0)
 {
     ++NG_cnt;
 }
@@ -142,12 +146,88 @@ bool NeurGrp::set_layer(const TInt& xlayer)
 //    firing rate
 //-------------------------------------------------
 TReal NeurGrp::eqn_firing(const TReal &V) const
+{
+    assert(_ng_state);
+    if (!_ng_fire_tbl.empty()) return fire_table(V);
+    return eqn_firing_exact(V);
+}
+
+TReal NeurGrp::eqn_firing_exact(const TReal &V) const
 {
     assert(_ng_state);
     //if(V <= V_0()) return 0.;
     return fire_max() / (1. + exp(fire_gain() * (fire_VHMF() - V)));
 }
 
+//-------------------------------------------------
+// function: bool NeurGrp::set_fire_table(const TReal &vmin, const TReal &vmax, const TReal &tol)
+//    Build the table of the firing function, a cubic Hermite 
+//    polynomial per interval from Q and dQ/dV at its ends. The 
+//    error of the interpolation is below h^4/384*max|d4Q/dV4|, 
+//    and max|d4Q/dV4| < Q_max*k^4/8, which gives the first 
+//    guess of the interval h. The error is measured at 7 points 
+//    per interval against eqn_firing_exact(), the intervals 
+//    are shortened by the fourth root of the excess until it is 
+//    at most tol*Q_max
+//-------------------------------------------------
+bool NeurGrp::set_fire_table(const TReal &vmin, const TReal &vmax, const TReal &tol)
+{
+    assert(_ng_state && vmax > vmin);
+
+    _ng_fire_tbl.clear();
+    _ng_fire_err = 0;
+    if (tol <= 0) return true;
+
+    TReal h = pow(384. * tol * 8. / pow(fire_gain(), 4), 0.25);
+    TInt num = std::max(16, static_cast<TInt>(std::min((vmax - vmin) / h + 1., 1. * FIRE_TABLE_MAX)));
+
+    vector<TReal> tbl;
+    TReal err = 0;
+    while (num <= FIRE_TABLE_MAX) {
+        h = (vmax - vmin) / num;
+        tbl.resize(4 * static_cast<size_t>(num));
+
+        TReal q0, d0, q1, d1, s;
+        s = 1. / (1. + exp(fire_gain() * (fire_VHMF() - vmin)));
+        q0 = fire_max() * s;
+        d0 = fire_max() * fire_gain() * s * (1. - s) * h; //dQ/dt
+        err = 0;
+        for (TInt i = 0; i < num; ++i) {
+            s = 1. / (1. + exp(fire_gain() * (fire_VHMF() - (vmin + (i + 1) * h))));
+            q1 = fire_max() * s;
+            d1 = fire_max() * fire_gain() * s * (1. - s) * h;
+
+            TReal *c = &tbl[4 * static_cast<size_t>(i)];
+            c[0] = q0;
+            c[1] = d0;
+            c[2] = 3. * (q1 - q0) - 2. * d0 - d1;
+            c[3] = 2. * (q0 - q1) + d0 + d1;
+
+            for (TInt j = 1; j < 8; ++j) {
+                TReal t = j / 8.;
+                TReal q = c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+                err = std::max(err, std::abs(q - eqn_firing_exact(vmin + (i + t) * h)));
+            }
+
+            q0 = q1;
+            d0 = d1;
+        }
+        err /= fire_max();
+        if (err <= tol) break;
+
+        num = std::max(num + 1, static_cast<TInt>(std::min(num * 1.05 * pow(err / tol, 0.25), FIRE_TABLE_MAX + 1.)));
+    }
+
+    if (num > FIRE_TABLE_MAX) return false;
+
+    _ng_fire_tbl.swap(tbl);
+    _ng_fire_vmin = vmin;
+    _ng_fire_inv = 1. / h;
+    _ng_fire_xmax = num;
+    _ng_fire_err = err;
+    return true;
+}
+
 void NeurGrp::swap(NeurGrp& p)
 {
     if (&p == this) return;
@@ -225,6 +305,16 @@ TReal NeurGrp::eqn_synp_ratio(const TReal& x, const TReal& y, const TReal& elmt_
             - erf(y_lower / (SQRT_2*_ng_paramVal[NG_IDX_SYNP_SIGMA])));
 }
 
+//the Gaussian distribution integrated over an element along one axis
+TReal NeurGrp::eqn_synp_ratio_1d(const TReal& x, const TReal& elmt_size) const
+{
+    TReal x_lower = x - 0.5*elmt_size;
+    TReal x_upper = x_lower + elmt_size;
+
+    return 0.5 * (erf(x_upper / (SQRT_2*_ng_paramVal[NG_IDX_SYNP_SIGMA]))
+        - erf(x_lower / (SQRT_2*_ng_paramVal[NG_IDX_SYNP_SIGMA])));
+}
+
 
 string NeurGrp::print(vector<Layer> LyArry) const
 {
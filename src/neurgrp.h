@@ -50,6 +50,11 @@
 #define SYNP_RATIO_EPS      	1e-4 /* in percentage */
 #endif
 
+//the largest number of intervals of the table of the firing function
+#ifndef FIRE_TABLE_MAX
+#define FIRE_TABLE_MAX      	(1 << 20)
+#endif
+
 #ifndef UNNAMED_NEURON_GROUP
 #define UNNAMED_NEURON_GROUP 	("UNNAMED_NEURON_GROUP")
 #endif
@@ -65,6 +70,23 @@ protected:
     std::vector<bool>    _ng_paramFlg;
     bool    _ng_state;
 
+    //the firing function as a cubic polynomial per interval of the membrane 
+    //potential, [interval][c0..c3] in the position t within the interval
+    std::vector<TReal>   _ng_fire_tbl;
+    TReal   _ng_fire_vmin;
+    TReal   _ng_fire_inv;  //intervals per mV
+    TReal   _ng_fire_xmax; //number of intervals
+    TReal   _ng_fire_err;  //largest error of the table relative to fire_max()
+
+    //the firing function from the table
+    inline TReal fire_table(const TReal& V) const {
+        TReal x = std::min(std::max((V - _ng_fire_vmin) * _ng_fire_inv, 0.), _ng_fire_xmax);
+        TInt  i = std::min(static_cast<TInt>(x), static_cast<TInt>(_ng_fire_xmax) - 1);
+        TReal t = x - i;
+        const TReal *c = &_ng_fire_tbl[4 * static_cast<size_t>(i)];
+        return c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+    };
+
     static TInt NG_cnt; // this is a static number for how many ng in the program
 
 public:
@@ -155,9 +177,27 @@ public:
     //the argument is the simulation time step
     void init(const TReal &);
 
-    //neuronal firing function 
+    //neuronal firing function, from the table if there is one (see set_fire_table())
     TReal eqn_firing(const TReal &) const; // return spike generation function
 
+    //eqn_firing() of num membrane potentials V[0], V[v_inc], ... written to Q[0], Q[q_inc], ...
+    template <class TV, class TQ>
+    void eqn_firing(const TV* V, const size_t& v_inc, TQ* Q, const size_t& q_inc, const TInt& num) const;
+
+    //neuronal firing function calculated with exp()
+    TReal eqn_firing_exact(const TReal &) const;
+
+    //build the table of the firing function over [vmin, vmax] with an error of at most 
+    //tol*fire_max(), which eqn_firing() then uses (V outside the range is taken at the 
+    //nearest end). tol = 0 removes the table. Return false if more than FIRE_TABLE_MAX
+    //intervals are needed
+    bool set_fire_table(const TReal& vmin, const TReal& vmax, const TReal& tol);
+
+    //return the number of intervals of the table (0 if there is none) and its 
+    //largest error relative to fire_max(), measured when it was built
+    inline TInt  fire_table_size(void) const { return _ng_fire_tbl.size() / 4; };
+    inline TReal fire_table_error(void) const { return _ng_fire_err; };
+
     //psp delay when propagating over a distance of s
     inline TReal eqn_psp_decay(const TReal &s) const;
 
@@ -165,6 +205,10 @@ public:
     //the distance between the two, and w is the size of elements
     TReal eqn_synp_ratio(const TReal &x, const TReal &y, const TReal &w) const;
 
+    //one factor of eqn_synp_ratio, i.e., 
+    //eqn_synp_ratio(x, y, w) == eqn_synp_ratio_1d(x, w) * eqn_synp_ratio_1d(y, w)
+    TReal eqn_synp_ratio_1d(const TReal &x, const TReal &w) const;
+
     //print out the neuron group settings
     std::string print(const std::vector<Layer> LyArry) const;
     std::string print() const;
@@ -183,6 +227,22 @@ inline void ng_swap(NeurGrp &a, NeurGrp &b)
     a.swap(b);
 }
 
+template <class TV, class TQ>
+void NeurGrp::eqn_firing(const TV* V, const size_t& v_inc, TQ* Q, const size_t& q_inc, const TInt& num) const
+{
+    assert(_ng_state);
+    if (_ng_fire_tbl.empty()) {
+        for (TInt idx = 0; idx < num; ++idx) {
+            Q[idx * q_inc] = static_cast<TQ>(eqn_firing_exact(V[idx * v_inc]));
+        }
+    }
+    else {
+        for (TInt idx = 0; idx < num; ++idx) {
+            Q[idx * q_inc] = static_cast<TQ>(fire_table(V[idx * v_inc]));
+        }
+    }
+}
+
 inline TReal NeurGrp::eqn_psp_decay(const TReal &s) const
 {
     assert(_ng_state);
@@ -283,6 +283,41 @@ void Rand::gauss_array(RandStream& stream, const double& mean, const double& sig
     }
 }
 
+//--------------------------------------------------------
+// function: unsigned long long Rand::hash(const unsigned long long &key)
+//   Counter-based random number generator, the 64-bit key is 
+//   scrambled using the finalizer of SplitMix64
+//     (Steele, Lea & Flood, OOPSLA 2014)
+//
+//   This function has no state, different keys give 
+//   statistically independent outputs
+//--------------------------------------------------------
+unsigned long long Rand::hash(const unsigned long long& key)
+{
+    unsigned long long z = key + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+//--------------------------------------------------------
+// function: double Rand::hash_gauss(const unsigned long long &key, 
+//                                  const double &mean, const double &sigma)
+//   Generate a random number with Gaussian PDF from a key,
+//   using the Box-Muller transform of two hashed uniform numbers
+//
+//   |result - mean| is bounded by HASH_GAUSS_MAX * sigma
+//--------------------------------------------------------
+double Rand::hash_gauss(const unsigned long long& key, const double& mean, const double& sigma)
+{
+    const double kTwoPi = 6.283185307179586;
+
+    double u1 = 1. - hash_rndm(2 * key); // (0, 1]
+    double u2 = hash_rndm(2 * key + 1);
+
+    return mean + sigma * sqrt(-2. * log(u1)) * cos(kTwoPi * u2);
+}
+
 #ifdef _OPENMP 
 //allocate more stream just in case hyper-threading programs 
 std::vector<RandStream> gRStreamArry(omp_get_max_threads());
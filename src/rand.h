@@ -43,6 +43,9 @@
 // would generate a random number evenly distributed between [0, 1)
 //   num = Rand::gauss(stream, mean, std);
 // would generate a random number with a gaussian PDF
+//   num = Rand::hash_gauss(key, mean, std);
+// would generate a gaussian random number from an integer key
+//   (no state, the same key always gives the same number)
 //---------------------------------------------------
 
 #include <cstdlib>
@@ -60,6 +63,12 @@
 #include "omp.h"
 #endif
 
+//upper bound of |z| for the standard Gaussian numbers from Rand::hash_gauss,
+//i.e., sqrt(-2*log(power(2, -53))), the uniform numbers have 53-bit resolution
+#ifndef HASH_GAUSS_MAX
+#define HASH_GAUSS_MAX  8.58
+#endif
+
 //---------------------------------------------------
 // Class RandSteam defines the state of 
 //   the random number generator
@@ -155,6 +164,16 @@ public:
         gauss_array(*stream, mean, sigma, n, arry);
     };
 
+    //counter-based generator: the result depends on the key only, 
+    //so the same number can be regenerated at any time without a stream
+    static unsigned long long hash(const unsigned long long& key);
+
+    static double hash_rndm(const unsigned long long& key) {
+        return static_cast<double>(hash(key) >> 11) * 1.1102230246251565e-16; // == * power(2, -53)
+    };
+
+    static double hash_gauss(const unsigned long long& key, const double& mean, const double& sigma);
+
     static bool is_ready() { return Rand_state; };
 };
 
@@ -174,6 +193,12 @@ inline unsigned int rand_seed(const int &thread = 0)
     }
 };
 
+//the stream of the calling thread
+inline RandStream& rand_stream(void)
+{
+    return gRStreamArry[(omp_get_thread_num())];
+};
+
 inline double rand_rndm(void)
 {
     return Rand::rndm(gRStreamArry[(omp_get_thread_num())]);
@@ -193,6 +218,11 @@ inline unsigned int rand_seed(void)
     return gRStream.get_seed();
 };
 
+inline RandStream& rand_stream(void)
+{
+    return gRStream;
+};
+
 inline double rand_rndm(void)
 {
     return Rand::rndm(gRStream);
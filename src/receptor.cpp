@@ -42,9 +42,16 @@ Receptor::Receptor(const string &xname) :
     _rcpt_name(xname),
     _rcpt_type(cNaN),
     _rcpt_state(false),
-    _rcpt_idx(RCPT_count)
-
+    _rcpt_idx(RCPT_count),
+    _iir_k0(0),
+    _iir_a(0),
+    _iir_b(0),
+    _iir_dev(0),
+    _iir_tail(0)
 {
+    _iir_p[0] = _iir_p[1] = 0;
+    _iir_q[0] = _iir_q[1] = 0;
+
     ++RCPT_count;
 };
 
@@ -254,14 +261,28 @@ TReal Receptor::eqn_J(const TReal &phi) const
 
     }
     else {
-        TReal y = x + 0.5;
         //taylor expansion for small x
-        return phi * (6.06530659712633E-01 + y * (6.06530659712633E-01 + y * (3.03265329856317E-01 + \
-            y * (1.01088443285439E-01 + y * (2.52721108213597E-02 + y * (5.05442216427195E-03 + \
-                y * (8.42403694045324E-04 + y * (1.20343384863618E-04 + y * (1.50429231079522E-05 + \
-                    y * 1.67143590088358E-06)))))))));
+        return phi * eqn_J_taylor(x);
+    }
+}
 
-        //calculation error is smaller than 10ppb for -1<x<0
+//------------------------------------------------
+// function: void Receptor::eqn_J(const TReal *phi, TReal *J, const TInt &num) const
+//   Equation J of an array, the Taylor expansion is taken for all 
+//   the values (a loop the compiler vectorises), then the few values 
+//   with x < -1 are replaced by phi*exp(x). The values are the same 
+//   as those of eqn_J(phi[i])
+//
+//------------------------------------------------
+void Receptor::eqn_J(const TReal* RESTRICT phi, TReal* RESTRICT J, const TInt &num) const
+{
+    for (TInt ii = 0; ii < num; ++ii) {
+        J[ii] = phi[ii] * eqn_J_taylor(_Jconst * phi[ii]);
+    }
+
+    for (TInt ii = 0; ii < num; ++ii) {
+        TReal x = _Jconst * phi[ii];
+        if (x < -1.0) J[ii] = phi[ii] * exp(x);
     }
 }
 
@@ -297,6 +318,43 @@ void Receptor::precalc(const TReal &step_size)
     }
 
     //cout<<name()<<": sum="<<sum<<endl;
+
+    //
+    // eqn_R is a difference of two exponentials, so the PSP after the
+    // delay is psp[k] = P*a^k - Q*b^k, which two states decaying by a and b
+    // generate in O(1) per step (see Simulation::add2volt()). The terms are
+    // calculated at the first steps directly, the states are checked against
+    // the time course over its length
+    //
+    const TReal h = step_size;
+    const TReal amp = gain() * (psp_rise() + psp_fall()) / (psp_fall() * psp_fall()) * h;
+    const TReal rate_b = 1.0 / psp_fall() + 1.0 / psp_rise();
+
+    _iir_k0 = 0;
+    while ((_iir_k0 + 0.5) * h <= delay()) ++_iir_k0;
+
+    _iir_a = exp(-h / psp_fall());
+    _iir_b = exp(-h * rate_b);
+    for (TInt ii = 0; ii < 2; ++ii) {
+        TReal t_m = delay() - (_iir_k0 + ii + 0.5) * h;
+        _iir_p[ii] = amp * exp(t_m / psp_fall());
+        _iir_q[ii] = amp * exp(t_m * rate_b);
+    }
+
+    TReal peak = 0, dev = 0, sum = 0;
+    TReal p = _iir_p[0], q = _iir_q[0];
+    for (TInt istep = _iir_k0; istep < Nstep; ++istep) {
+        peak = std::max(peak, std::abs(_rcpt_psp[istep]));
+        dev = std::max(dev, std::abs(p - q - _rcpt_psp[istep]));
+        sum += _rcpt_psp[istep];
+        p *= _iir_a;
+        q *= _iir_b;
+    }
+    _iir_dev = (peak > 0) ? dev / peak : 0;
+
+    //the whole PSP, the sum of the two geometric series
+    TReal total = _iir_p[0] / (1.0 - _iir_a) - _iir_q[0] / (1.0 - _iir_b);
+    _iir_tail = (total != 0) ? (total - sum) / total : 0;
 }
 
 //-------------------------------------------------
@@ -51,6 +51,14 @@
 //program significantly
 #endif
 
+//-----------------------------------------------
+// The largest deviation of the recursive kernel
+// from the PSP time course (relative to its peak)
+//-----------------------------------------------
+#ifndef PSP_IIR_TOL
+#define PSP_IIR_TOL            1e-9
+#endif
+
 //using namespace std;
 
 //-------------------------------------------
@@ -74,6 +82,17 @@ private:
 
     TInt                 _rcpt_idx;
 
+    //the PSP from the step _iir_k0 on is P*a^k - Q*b^k (see eqn_R), two 
+    //states decaying by _iir_a and _iir_b per step. _iir_p[i] and _iir_q[i]
+    //are the terms at the step _iir_k0 + i
+    TInt                 _iir_k0;
+    TReal                _iir_a;
+    TReal                _iir_b;
+    TReal                _iir_p[2];
+    TReal                _iir_q[2];
+    TReal                _iir_dev;  //largest deviation from the PSP time course, relative to its peak
+    TReal                _iir_tail; //share of the PSP after the end of the time course
+
     static TInt          RCPT_count;
 
 public:
@@ -114,12 +133,32 @@ public:
 
     inline TInt   psp_size(void) const { return _rcpt_psp.size(); };
 
+    //the PSP as a recursion, see precalc(): the first step of the PSP, the decay 
+    //factors of the two states per step, and their terms at the step iir_k0() + i
+    //(i = 0 or 1)
+    inline TInt   iir_k0(void) const { return _iir_k0; };
+
+    inline TReal  iir_a(void) const { return _iir_a; };
+
+    inline TReal  iir_b(void) const { return _iir_b; };
+
+    inline TReal  iir_p(const TInt& i) const { return _iir_p[i]; };
+
+    inline TReal  iir_q(const TInt& i) const { return _iir_q[i]; };
+
+    inline TReal  iir_deviation(void) const { return _iir_dev; };
+
+    inline TReal  iir_tail(void) const { return _iir_tail; };
+
     void  init(void);
 
     void  precalc(const TReal& step_size);
 
     TReal eqn_J(const TReal& phi) const;
 
+    //J[i] = eqn_J(phi[i]) for i < num, the same values without a branch per value
+    void  eqn_J(const TReal* RESTRICT phi, TReal* RESTRICT J, const TInt& num) const;
+
     TReal eqn_R(const TReal& tau) const;
 
     std::string print(void) const;
@@ -142,4 +181,33 @@ inline void rcpt_swap(Receptor& a, Receptor& b)
     a.swap(b);
 }
 
+//----------------------------------------------------
+// function: inline TReal eqn_J_taylor(const TReal& x)
+//   exp(x) by the Taylor expansion at x = -0.5, used by Receptor::eqn_J()
+//   for -1 <= x <= 0, the error is smaller than 10ppb
+//
+//----------------------------------------------------
+inline TReal eqn_J_taylor(const TReal& x)
+{
+    TReal y = x + 0.5;
+    return 6.06530659712633E-01 + y * (6.06530659712633E-01 + y * (3.03265329856317E-01 + \
+        y * (1.01088443285439E-01 + y * (2.52721108213597E-02 + y * (5.05442216427195E-03 + \
+            y * (8.42403694045324E-04 + y * (1.20343384863618E-04 + y * (1.50429231079522E-05 + \
+                y * 1.67143590088358E-06))))))));
+}
+
+//----------------------------------------------------
+// function: inline void rcpt_eqn_J(const std::vector<Receptor>& rcpt, 
+//      const TReal* phi, const TInt& num, TReal* J)
+//   eqn_J of num values phi for all the receptors of rcpt,
+//   J[i + num*ircpt] = rcpt[ircpt].eqn_J(phi[i])
+//
+//----------------------------------------------------
+inline void rcpt_eqn_J(const std::vector<Receptor>& rcpt, const TReal* phi, const TInt& num, TReal* J)
+{
+    for (size_t ircpt = 0; ircpt < rcpt.size(); ++ircpt) {
+        rcpt[ircpt].eqn_J(phi, J + num * ircpt, num);
+    }
+}
+
 #endif /* end of #ifndef RECEPTOR_H */
@@ -21,13 +21,45 @@
 #include <algorithm>
 using namespace std;
 
+//the constants of the neuron groups, the synapses and the PSP tables read by
+//the step. A model compiled by lcmc has them in the namespace lcm_model (see
+//lcmc.cpp), then S is a source group known at compile time, the loops over
+//the groups and the synapses have constant bounds, and the weights, the 
+//delays and the tables are constants. runlcm reads the loaded model
+#ifdef LCM_MODEL
+#define MODEL_NG_NUM                    lcm_model::ng_num
+#define MODEL_NG(ineur, field)          lcm_model::ng_##field[ineur]
+#define MODEL_SYNP_NUM(S, sn)           (lcm_model::synp_ptr[(S) + 1] - lcm_model::synp_ptr[S])
+#define MODEL_SYNP(S, sn, isynp, field) lcm_model::synp_##field[lcm_model::synp_ptr[S] + (isynp)]
+#define MODEL_PSP(S, rcpt, ircpt)       lcm_model::psp_table[lcm_model::ng_rcpt[(S) * lcm_model::rcpt_num + (ircpt)]]
+#define MODEL_PSP_SIZE(S, rcpt, ircpt)  lcm_model::psp_size[lcm_model::ng_rcpt[(S) * lcm_model::rcpt_num + (ircpt)]]
+#else
+#define MODEL_NG_NUM                    gNG_num
+#define MODEL_NG(ineur, field)          gNeur[ineur].field()
+#define MODEL_SYNP_NUM(S, sn)           static_cast<TInt>((sn).synp_conn().size())
+#define MODEL_SYNP(S, sn, isynp, field) (sn).synp_conn()[isynp].field()
+#define MODEL_PSP(S, rcpt, ircpt)       (rcpt)[ircpt].psp()
+#define MODEL_PSP_SIZE(S, rcpt, ircpt)  (rcpt)[ircpt].psp_size()
+#endif
+
 //--------------------------------------------------
 // function Simulation::Simulation(void)
 //   default constructor
 //--------------------------------------------------
 Simulation::Simulation(void) :
-   LCM(), gPSP(NULL), gVolt(NULL), tCheck_pnt(0),
-   tEvlt_step(0), gRand_seed(0), gThread_num(0), 
+   LCM(), gPSP_rcpt_num(0), gElmt_pad(0), gPSP_slot_num(0), gVolt_slot_num(0),
+   tPSP_front(0), tVolt_rear(0), gKernel(KERNEL_TABLE), gIIR_rcpt_num(0), gElmt_cfg(ORDER_ROW), gElmt_order(ORDER_ROW),
+   gProc_num(1), gTrans(NULL), gElmt_bgn(0), gElmt_own(0), gElmt_col(0), gSymm_cfg(SYMM_OFF), gSymm(false),
+   gSymm_conn(0), gEns_num(1), tCheck_pnt(0),
+   tEvlt_step(0), gRand_seed(0), gThread_num(0), gThread_pin(0), gEngine(ENGINE_SPARSE), gSimd(SIMD_NONE),
+   gPrecision(PRECISION_DOUBLE), gPrec_dev(0.), gPrec_mag(0.), gBlock_cfg(0), gBlock_step(1),
+   tTeam_stop(0), tTeam_step(0), tTeam_block(false),
+   gGate_eps(0.), gGate_skip(0.), gGate_num(0.),
+   gFar_radius(0.), gFar_block(FAR_BLOCK_DEFAULT), gFar_eps(FAR_EPS_DEFAULT), gFar_side(0), gFar_blk_num(0), gFar_pad(0),
+   gFar_conn(0.), gFar_tap(0.), gFar_dev(0.),
+   gChan_rcpt_num(0),
+   gPush_slot_num(1), gPush_dmax(0), gPush_smax(0), gPush_ratio(0.), tPush_on(false), gPush_steps(0), tPush_replay(false),
+   gFFT_ring_size(0), 
    cfg_file("UNKNOWN"), tOut_flg(false), simu_state(false)
 {  }
 
@@ -37,26 +69,10 @@ Simulation::Simulation(void) :
 //--------------------------------------------------
 Simulation::~Simulation(void)
 {
-   //delete gPSP
-   if (gPSP != NULL) {
-      for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
-         for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
-            delete[] gPSP[ielmt][ineur];
-         }
-         delete[] gPSP[ielmt];
-      }
-      delete[] gPSP;
-      gPSP = NULL;
-   }
+   //the arenas gPSP and gVolt are released by themselves
 
-   //delete gVolt
-   if (gVolt != NULL) {
-      for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
-         delete[] gVolt[ielmt];
-      }
-      delete[] gVolt;
-      gVolt = NULL;
-   }
+   //the first process waits for the others
+   delete gTrans;
 }
 
 void Simulation::load_from_file(const string& fname)
@@ -68,8 +84,6 @@ void Simulation::load_from_file(const string& fname)
       exit(-1);
    }
 
-   cfg_file = fname;
-
    std::string str;
 
    fp.seekg(0, std::ios::end);  //get to the end of the file 
@@ -81,14 +95,21 @@ void Simulation::load_from_file(const string& fname)
 
    fp.close();
 
+   load_from_text(str, fname);
+}
+
+void Simulation::load_from_text(const string& text, const string& fname, const bool& model_only)
+{
+   cfg_file = fname;
+
    map<string, string> paramList;
 
-   if (!read_param(str, paramList)) {
-      cerr << "Simulation::load_from_file: fail to read parameters from text." << _FILE_LINE_ << endl;
+   if (!read_param(text, paramList)) {
+      cerr << "Simulation::load_from_text: fail to read parameters from text." << _FILE_LINE_ << endl;
       exit(-1);
    }
 
-   load(paramList);
+   load(paramList, model_only);
 }
 
 
@@ -97,9 +118,10 @@ void Simulation::load_from_file(const string& fname)
 //   this function will load the parameters from a file
 //   fname is the path to the parameter file
 //  
-//   this function also initialises the meodel
+//   this function also initialises the meodel, and the
+//   simulation unless model_only
 //--------------------------------------------------
-void Simulation::load(map<string, string> &paramList)
+void Simulation::load(map<string, string> &paramList, const bool& model_only)
 {
    string paramName, paramVal;
    vector<string> parts;
@@ -212,7 +234,250 @@ void Simulation::load(map<string, string> &paramList)
       gThread_num = 0;
    }
 
-   rand_init(gRand_seed, gThread_num);
+   it = paramList.find("SIMU.THREAD_PIN");
+   if (it != paramList.end()) {
+      TInt int_val;
+      if ((!str2int(it->second, int_val)) || int_val < 0 || int_val > 1) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gThread_pin = int_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gThread_pin = 0;
+   }
+
+   it = paramList.find("SIMU.PROC_NUM");
+   if (it != paramList.end()) {
+      TInt int_val;
+      if ((!str2int(it->second, int_val)) || int_val < 1) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gProc_num = int_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gProc_num = 1;
+   }
+
+   it = paramList.find("SIMU.ENGINE");
+   if (it != paramList.end()) {
+      TInt int_val;
+      if ((!str2int(it->second, int_val)) || int_val < ENGINE_AUTO || int_val > ENGINE_PUSH) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gEngine = int_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gEngine = ENGINE_SPARSE;
+   }
+
+   it = paramList.find("SIMU.SIMD");
+   if (it != paramList.end()) {
+      TInt int_val;
+      if ((!str2int(it->second, int_val)) || int_val < SIMD_AUTO || int_val > SIMD_AVX512) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gSimd = int_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gSimd = SIMD_NONE;
+   }
+
+   it = paramList.find("SIMU.PRECISION");
+   if (it != paramList.end()) {
+      TInt int_val;
+      if ((!str2int(it->second, int_val)) || int_val < PRECISION_DOUBLE || int_val > PRECISION_VALIDATE) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gPrecision = int_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gPrecision = PRECISION_DOUBLE;
+   }
+
+   it = paramList.find("SIMU.PSP_KERNEL");
+   if (it != paramList.end()) {
+      TInt int_val;
+      if ((!str2int(it->second, int_val)) || int_val < KERNEL_TABLE || int_val > KERNEL_VALIDATE) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gKernel = int_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gKernel = KERNEL_TABLE;
+   }
+
+   it = paramList.find("SIMU.BLOCK_STEP");
+   if (it != paramList.end()) {
+      TInt int_val;
+      if ((!str2int(it->second, int_val)) || int_val < 0) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gBlock_cfg = int_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gBlock_cfg = 0;
+   }
+
+   it = paramList.find("SIMU.GATE_EPS");
+   if (it != paramList.end()) {
+      TReal real_val;
+      if ((!str2float(it->second, real_val)) || real_val < 0.) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gGate_eps = real_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gGate_eps = 0.;
+   }
+
+   it = paramList.find("SIMU.FAR_RADIUS");
+   if (it != paramList.end()) {
+      TReal real_val;
+      if ((!str2float(it->second, real_val)) || real_val < 0.) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gFar_radius = real_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gFar_radius = 0.;
+   }
+
+   it = paramList.find("SIMU.FAR_BLOCK");
+   if (it != paramList.end()) {
+      TInt int_val;
+      if ((!str2int(it->second, int_val)) || int_val < 1) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gFar_block = int_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gFar_block = FAR_BLOCK_DEFAULT;
+   }
+
+   it = paramList.find("SIMU.FAR_EPS");
+   if (it != paramList.end()) {
+      TReal real_val;
+      if ((!str2float(it->second, real_val)) || real_val <= 0.) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gFar_eps = real_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gFar_eps = FAR_EPS_DEFAULT;
+   }
+
+   it = paramList.find("SIMU.SYMMETRY");
+   if (it != paramList.end()) {
+      TInt int_val;
+      if ((!str2int(it->second, int_val)) || int_val < SYMM_AUTO || int_val > SYMM_ON) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gSymm_cfg = int_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gSymm_cfg = SYMM_OFF;
+   }
+
+   it = paramList.find("SIMU.ELMT_ORDER");
+   if (it != paramList.end()) {
+      TInt int_val;
+      if ((!str2int(it->second, int_val)) || int_val < ORDER_AUTO || int_val > ORDER_MORTON) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gElmt_cfg = int_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gElmt_cfg = ORDER_ROW;
+   }
+
+   it = paramList.find("SIMU.ENSEMBLE");
+   if (it != paramList.end()) {
+      TInt int_val;
+      if ((!str2int(it->second, int_val)) || int_val < 1 || int_val > ENSEMBLE_MAX) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         exit(-1);
+      }
+      gEns_num = int_val;
+
+      paramList.erase(it);
+   }
+   else {
+      gEns_num = 1;
+   }
+
+   gEns_scale.assign(gEns_num, 1.);
+   it = paramList.find("SIMU.ENSEMBLE_SCALE");
+   if (it != paramList.end()) {
+      string val = strtrim(it->second);
+      bool flg = (val.size() >= 2 && val[0] == '{' && val[val.size() - 1] == '}');
+      if (flg) {
+         strsplit(val.substr(1, val.size() - 2), ",", parts); //like "{1, 1.1, 0.9, 1.2}"
+         flg = (parts.size() == gEns_num);
+      }
+      for (TInt iens = 0; iens < gEns_num && flg; ++iens) {
+         flg = str2float(strtrim(parts[iens]), gEns_scale[iens]) && gEns_scale[iens] >= 0.;
+      }
+      if (!flg) {
+         cerr << msg_invalid_param_value(it->first, it->second) << endl;
+         cerr << "   the value of parameter '" << it->first << "' should be " << gEns_num 
+            << " factors (SIMU.ENSEMBLE) embraced by a pair of '{}'" << endl;
+         exit(-1);
+      }
+
+      paramList.erase(it);
+   }
+
+   //the processes of a distributed run draw the same random numbers (the synapse 
+   //jitter and the stimulators), so a seed from the clock is taken before they start
+   unsigned int seed = gRand_seed;
+   if (seed == 0 && gProc_num > 1) seed = static_cast<unsigned int>(time(NULL) & 0x7fffffff);
+
+   if (!model_only) {
+      init_proc();
+
+      init_thread();
+   }
+
+   rand_init(seed, gThread_num);
 
    //processing the rest of the list 
    if (!LCM::set_param(paramList)) {
@@ -220,7 +485,13 @@ void Simulation::load(map<string, string> &paramList)
       exit(-1);
    }
 
-   if (!Simulation::init()) {
+   if (model_only) {
+      if (!LCM::init()) {
+         cerr << "ERROR! intialising the model failed! " << _FILE_LINE_ << endl;
+         exit(-1);
+      }
+   }
+   else if (!Simulation::init()) {
       cerr << "ERROR! intialising the simulation failed! " << _FILE_LINE_ << endl;
       exit(-1);
    }
@@ -243,61 +514,19 @@ bool Simulation::init(void)
    if (!LCM::init())
       return false;
 
-   //allocate space for gElmtX and gElmtY
-   gElmtX.resize(gElmt_num);
-   gElmtY.resize(gElmt_num);
-
-   for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
-      gElmtY[ielmt] = ielmt / gGrid_row;
-      gElmtX[ielmt] = ielmt - gElmtY[ielmt] * gGrid_row;
-   }
+   if (!init_order())
+      return false;
 
-   //delete gPSP
-   if (gPSP != NULL) {
-      for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
-         for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
-            delete[] gPSP[ielmt][ineur];
-         }
-         delete[] gPSP[ielmt];
-      }
-      delete[] gPSP;
-      gPSP = NULL;
-   }
+   if (!init_domain())
+      return false;
 
-   //delete gVolt
-   if (gVolt != NULL) {
-      for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
-         delete[] gVolt[ielmt];
-      }
-      delete[] gVolt;
-      gVolt = NULL;
-   }
+   if (!init_symm())
+      return false;
 
    TInt max_Nrcpt = gRcpt_excit.size();
    if (max_Nrcpt < gRcpt_inhib.size())
       max_Nrcpt = gRcpt_inhib.size();
 
-   //Nneur_x_Nrcpt=gNG_num * max_Nrcpt;
-   try {
-      gPSP = new DynamicArray**[gElmt_num];
-      for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
-         gPSP[ielmt] = new DynamicArray*[gNG_num];
-         for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
-            gPSP[ielmt][ineur] = new DynamicArray[max_Nrcpt];
-         }
-      }
-
-      gVolt = new DynamicArray*[gElmt_num];
-      for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
-         gVolt[ielmt] = new DynamicArray[gNG_num];
-      }
-
-   }
-   catch (bad_alloc& e) {
-      cerr << msg_allocation_error(e) << endl;
-      exit(-1);
-   }
-
    //determin the length for voltage array
    TInt  max_psp_size = 0;
    for (vector<Receptor>::iterator rc_it = gRcpt_excit.begin(); rc_it != gRcpt_excit.end(); ++rc_it) {
@@ -309,203 +538,2576 @@ bool Simulation::init(void)
    }
 
    TInt max_psp_delay = 0;
+   TInt max_iir_k0 = 0;
    TInt max_elmt_delay = 0;
    TInt max_spk_delay = 0;
+   vector<TInt> grp_delay(gNG_num, 0); //the longest delay a synapse of a group reads the PSP at
    for (vector<NeurGrp>::iterator ng_it = gNeur.begin(); ng_it != gNeur.end(); ++ng_it) {
-      max_elmt_delay = std::max(max_elmt_delay, gSpk_delay[ng_it->index()][SPK_DELAY_IDX(gGrid_row, gGrid_row, 0)]);
+      //the longest pathway, SPK_DELAY_IDX(0, 0, 3), goes over both boundaries
+      max_elmt_delay = std::max(max_elmt_delay, *std::max_element(gSpk_delay[ng_it->index()],
+         gSpk_delay[ng_it->index()] + gGrid_row * gGrid_row * SPK_PATH_NUM));
       for (vector<SynpConn>::const_iterator sy_it = ng_it->synp_conn().begin(); sy_it != ng_it->synp_conn().end(); ++sy_it) {
          max_psp_delay = std::max(max_psp_delay, sy_it->psp_delay());
          max_spk_delay = std::max(max_spk_delay, sy_it->spk_delay());
+         grp_delay[ng_it->index()] = std::max(grp_delay[ng_it->index()], sy_it->spk_delay() + conn_delay_max(ng_it->index()));
       }
    }
 
+   //temporal blocking, see Simulation::advance(const TInt&)
+   gBlock_step = 1;
+   if (gEngine == ENGINE_SPARSE) {
+      gBlock_step = (gBlock_cfg == 0) ? block_step_max() : std::min(gBlock_cfg, block_step_max());
+   }
+   gBlock_phi.clear();
+
    TInt volt_arry_size = nextpow2(max_psp_size + max_psp_delay + 1);
-   TInt psp_arry_size = nextpow2(max_elmt_delay + max_spk_delay + 1);
 
-   //cout<<"Voltage buff size="<<gVolt_arry_size<<endl;
-   //cout<<"PSP buff size="<<gpsp_arry_size<<endl;
+   //with the recursive kernels the ring only holds the delay lines of the 
+   //states, which start at the step after the delay of the receptor 
+   //(KERNEL_VALIDATE keeps the ring of the time courses for both)
+   TReal iir_dev = 0, iir_tail = 0;
+   if (gKernel != KERNEL_TABLE) {
+      gIIR_a.clear();
+      gIIR_b.clear();
+      for (TInt itype = 0; itype < 2; ++itype) {
+         const vector<Receptor>& rcpt = (itype == 0) ? gRcpt_excit : gRcpt_inhib;
+         for (vector<Receptor>::const_iterator rc_it = rcpt.begin(); rc_it != rcpt.end(); ++rc_it) {
+            if (rc_it->iir_deviation() > PSP_IIR_TOL) {
+               cerr << "ERROR! SIMU.PSP_KERNEL = " << gKernel << ": the recursive kernel of " << rc_it->name()
+                  << " deviates from its PSP by " << rc_it->iir_deviation() << " of the peak. " << _FILE_LINE_ << endl;
+               return false;
+            }
+            iir_dev = std::max(iir_dev, rc_it->iir_deviation());
+            iir_tail = std::max(iir_tail, std::abs(rc_it->iir_tail()));
+            max_iir_k0 = std::max(max_iir_k0, rc_it->iir_k0());
+            gIIR_a.push_back(rc_it->iir_a());
+            gIIR_b.push_back(rc_it->iir_b());
+         }
+      }
+
+      TInt max_src_delay = 0;
+      for (vector<ExSource>::const_iterator es_it = gExSrc.begin(); es_it != gExSrc.end(); ++es_it) {
+         for (vector<SynpConn>::const_iterator sy_it = es_it->synp_conn().begin(); sy_it != es_it->synp_conn().end(); ++sy_it) {
+            max_src_delay = std::max(max_src_delay, sy_it->psp_delay());
+         }
+      }
+      if (gKernel == KERNEL_IIR)
+         volt_arry_size = nextpow2(std::max(max_psp_delay, max_src_delay) + max_iir_k0 + 2);
+   }
+
+   //the PSP ring of a group holds the longest delay of its kept pathways plus the 
+   //spike delay of its synapses (the pathways to the far corners of the grid have 
+   //a ratio of zero), and the steps of a block
+   gPSP_ring.resize(gNG_num);
+   TInt psp_arry_size = 1;
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      gPSP_ring[ineur] = nextpow2(grp_delay[ineur] + gBlock_step);
+      psp_arry_size = std::max(psp_arry_size, gPSP_ring[ineur]);
+   }
 
    //
-   // reserve space for the voltage of each element
-   // there is no advantage to parallelise  the section in 
-   // memory allocation in operating system is running in a single thread 
+   // reserve space for the histories of all the elements, 
+   // the rings are filled with the resting potential and zero PSP
+   //
+   gPSP_rcpt_num = max_Nrcpt;
+   gElmt_pad = (gElmt_col + ALIGNED_ARRAY_BYTES / sizeof(TFloat) - 1) / (ALIGNED_ARRAY_BYTES / sizeof(TFloat))
+      * (ALIGNED_ARRAY_BYTES / sizeof(TFloat));
+   gPSP_slot_num = psp_arry_size;
+   gVolt_slot_num = volt_arry_size;
+   tPSP_front = 0;
+   tVolt_rear = 0;
+
+   if (gPrecision != PRECISION_DOUBLE && gEngine != ENGINE_SPARSE) {
+      cerr << "ERROR! SIMU.PRECISION = " << gPrecision << " requires SIMU.ENGINE = " << ENGINE_SPARSE << ". " << _FILE_LINE_ << endl;
+      return false;
+   }
 
-   for (TInt ielmt = 0; ielmt != gElmt_num; ++ielmt) {
-      for (TInt ineur = 0; ineur != gNG_num; ++ineur) {
-         //idx=ielmt*gNG_num+ineur;
-         gVolt[ielmt][ineur].resize(volt_arry_size);
-         gVolt[ielmt][ineur].set_default(gNeur[ineur].V_0());
-         gVolt[ielmt][ineur].fill(gNeur[ineur].V_0());
+   if (gEns_num > 1 && (gEngine != ENGINE_SPARSE || gPrecision != PRECISION_DOUBLE || gGate_eps > 0. || gProc_num > 1)) {
+      cerr << "ERROR! SIMU.ENSEMBLE = " << gEns_num << " requires SIMU.ENGINE = " << ENGINE_SPARSE 
+         << ", SIMU.PRECISION = " << PRECISION_DOUBLE << ", SIMU.GATE_EPS = 0 and SIMU.PROC_NUM = 1. " << _FILE_LINE_ << endl;
+      return false;
+   }
 
-         gVolt[ielmt][ineur].step_backward();
+   //the PSP history is kept in the precision(s) the gather uses, the rings of the 
+   //groups one after the other
+   gPSP_off.assign(gNG_num + 1, 0);
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      gPSP_off[ineur + 1] = gPSP_off[ineur] + static_cast<size_t>(gPSP_ring[ineur]) * gPSP_rcpt_num * gElmt_pad * gEns_num;
+   }
+   const size_t psp_full = static_cast<size_t>(nextpow2(max_elmt_delay + max_spk_delay + gBlock_step)) 
+      * gNG_num * gPSP_rcpt_num * gElmt_pad * gEns_num;
+
+   gPSP.clear();
+   gPSP_sp.clear();
+   if (gPrecision != PRECISION_SINGLE)
+      gPSP.allocate(gPSP_off[gNG_num]);
+   if (gPrecision != PRECISION_DOUBLE)
+      gPSP_sp.allocate(gPSP_off[gNG_num]);
+
+   gVolt.allocate(static_cast<size_t>(gElmt_own) * gNG_num * gVolt_slot_num * gEns_num);
+
+   gIIR.clear();
+   gVolt_iir.clear();
+   gIIR_dev.clear();
+   gIIR_rcpt_num = 0;
+   if (gKernel != KERNEL_TABLE) {
+      gIIR_rcpt_num = gRcpt_excit.size() + gRcpt_inhib.size();
+      gIIR.allocate(static_cast<size_t>(gElmt_own) * gNG_num * gIIR_rcpt_num * (2 * gVolt_slot_num + 2) * gEns_num);
+   }
+   if (gKernel == KERNEL_VALIDATE) {
+      gVolt_iir.allocate(gVolt.size());
+      gIIR_dev.assign(gElmt_own, 0.);
+   }
 
-         if (gNeur[ineur].type() == cEXCIT) {
-            //for excitatory neuron only gRcpt[ielmt][ineur][0-1] is valid
-            for (std::size_t ircpt = 0; ircpt != gRcpt_excit.size(); ++ircpt) {
-               //idx=ielmt*Nneur_x_Nrcpt+ineur*max_Nrcpt+ircpt;
-               gPSP[ielmt][ineur][ircpt].resize(psp_arry_size);
-               gPSP[ielmt][ineur][ircpt].set_default(0);
-               gPSP[ielmt][ineur][ircpt].fill(0);
+   //the rings are filled with the resting potential and zero PSP by the threads 
+   //advancing the elements (the loops of step_team()), so the pages of an element 
+   //are placed on the NUMA node of its thread (first touch)
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+   for (TInt ielmt = 0; ielmt < gElmt_col; ++ielmt) {
+      for (TInt iens = 0; iens < gEns_num && ielmt < gElmt_own; ++iens) {
+         for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+            TReal *volt_ring = gVolt.data() + VOLT_IDX_AT(0, ielmt + gElmt_own * iens, ineur, 0);
+            std::fill(volt_ring, volt_ring + gVolt_slot_num, gNeur[ineur].V_0());
+            if (gKernel == KERNEL_VALIDATE) {
+               volt_ring = gVolt_iir.data() + VOLT_IDX_AT(0, ielmt + gElmt_own * iens, ineur, 0);
+               std::fill(volt_ring, volt_ring + gVolt_slot_num, gNeur[ineur].V_0());
+            }
+            if (gKernel != KERNEL_TABLE) {
+               TReal *iir = gIIR.data() + IIR_IDX(ielmt + gElmt_own * iens, ineur, 0);
+               std::fill(iir, iir + gIIR_rcpt_num * (2 * gVolt_slot_num + 2), 0.);
             }
          }
-         else {
-            //for inhibitory neuron only gRcpt[ielmt][ineur][0] is valid 
-            for (std::size_t ircpt = 0; ircpt != gRcpt_inhib.size(); ++ircpt) {
-               //idx=ielmt*Nneur_x_Nrcpt+ineur*max_Nrcpt+ircpt;
-               gPSP[ielmt][ineur][ircpt].resize(psp_arry_size);
-               gPSP[ielmt][ineur][ircpt].set_default(0);
-               gPSP[ielmt][ineur][ircpt].fill(0);
+      }
+      for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+         for (TInt islot = 0; islot < gPSP_ring[ineur]; ++islot) {
+            for (TInt ircpt = 0; ircpt < gPSP_rcpt_num; ++ircpt) {
+               for (TInt iens = 0; iens < gEns_num; ++iens) {
+                  set_psp(islot, ielmt, ineur, ircpt, 0., iens);
+               }
             }
          }
+      }
+   }
 
+   //the padding of the PSP planes
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      for (TInt islot = 0; islot < gPSP_ring[ineur]; ++islot) {
+         for (TInt ircpt = 0; ircpt < gPSP_rcpt_num; ++ircpt) {
+            for (TInt ielmt = gElmt_col; ielmt < gElmt_pad; ++ielmt) {
+               for (TInt iens = 0; iens < gEns_num; ++iens) {
+                  set_psp(islot, ielmt, ineur, ircpt, 0., iens);
+               }
+            }
+         }
       }
    }
 
-   //check the output time window
-   for (vector<TTimeWin>::iterator it = output_time.begin(); it != output_time.end(); ++it) {
-      it->bgn_step = static_cast<TInt>(it->bgn_time / LCM::time_step());
-      it->end_step = static_cast<TInt>(it->end_time / LCM::time_step());
-      it->inc_step = static_cast<TInt>(it->inc_time / LCM::time_step());
+   gPrec_dev = 0.;
+   gPrec_mag = 0.;
+
+   if (gGate_eps > 0. && gEngine != ENGINE_SPARSE) {
+      cerr << "ERROR! SIMU.GATE_EPS > 0 requires SIMU.ENGINE = " << ENGINE_SPARSE << ". " << _FILE_LINE_ << endl;
+      return false;
+   }
+
+   //activity gating, the rings are filled with zero PSP
+   gGate_mid.clear();
+   gGate_dev.clear();
+   if (gGate_eps > 0.) {
+      gGate_mid.resize(static_cast<size_t>(gPSP_slot_num) * gNG_num * gPSP_rcpt_num, 0.);
+      gGate_dev.resize(static_cast<size_t>(gPSP_slot_num) * gNG_num * gPSP_rcpt_num, 0.);
+   }
+
+   gGate_skip = 0.;
+   gGate_num = 0.;
+
+   //the connection list, with the ratios in single precision and 
+   //the sums of the buckets (the gating and the push) if needed
+   gConn_pct_sp.clear();
+   gBkt_wsum.clear();
+   if (synp_store() == SYNP_STORE_TABLE || gSymm) place_conn();
+
+   if (gFar_radius > 0. && (gEngine != ENGINE_SPARSE || synp_store() != SYNP_STORE_TABLE || gPrecision != PRECISION_DOUBLE
+      || gGate_eps > 0. || gProc_num > 1 || gEns_num > 1)) {
+      cerr << "ERROR! SIMU.FAR_RADIUS > 0 requires SIMU.ENGINE = " << ENGINE_SPARSE << ", LCM.SYNP_STORE = " << SYNP_STORE_TABLE
+         << ", SIMU.PRECISION = " << PRECISION_DOUBLE << ", SIMU.GATE_EPS = 0, SIMU.PROC_NUM = 1 and SIMU.ENSEMBLE = 1. "
+         << _FILE_LINE_ << endl;
+      return false;
+   }
+
+   if (!init_far())
+      return false;
+
+   if (!gGather.set(gSimd)) {
+      cerr << "ERROR! SIMU.SIMD = " << gSimd << " (" << Gather::name(gSimd) 
+         << ") is not supported by the processor. " << _FILE_LINE_ << endl;
+      return false;
+   }
+
+   if (gEngine == ENGINE_FFT && !init_fft())
+      return false;
+
+   if (gEngine == ENGINE_SEPARABLE && !init_sep())
+      return false;
+
+   if ((gEngine == ENGINE_PUSH || gEngine == ENGINE_AUTO) && !init_push())
+      return false;
+
+   init_step_buf();
+
+   //check the output time window
+   for (vector<TTimeWin>::iterator it = output_time.begin(); it != output_time.end(); ++it) {
+      it->bgn_step = static_cast<TInt>(it->bgn_time / LCM::time_step());
+      it->end_step = static_cast<TInt>(it->end_time / LCM::time_step());
+      it->inc_step = static_cast<TInt>(it->inc_time / LCM::time_step());
       if (it->inc_step <= 0) it->inc_time = 1;
       it->pnt_num = (it->end_step - it->bgn_step) / it->inc_step + 1;
    }
 
-   //check point
-   tCheck_pnt = MAX_INT_NUM;
-   for (vector<ExSource>::iterator it = gExSrc.begin(); it != gExSrc.end(); ++it) {
-      it->init();
-      if (tCheck_pnt > it->check_point())
-         tCheck_pnt = it->check_point();
+   //check point
+   tCheck_pnt = MAX_INT_NUM;
+   for (vector<ExSource>::iterator it = gExSrc.begin(); it != gExSrc.end(); ++it) {
+      it->init();
+      if (tCheck_pnt > it->check_point())
+         tCheck_pnt = it->check_point();
+   }
+
+   //the stimulators of the other members of the ensemble have the same check points,
+   //they draw their seeds from a stream of their own, see begin_step()
+   gEns_src.assign(gEns_num - 1, gExSrc);
+   gEns_rand.set_seed(static_cast<unsigned int>(Rand::hash(rand_seed()) & 0x7fffffff));
+   std::swap(rand_stream(), gEns_rand);
+   for (vector<vector<ExSource> >::iterator ens_it = gEns_src.begin(); ens_it != gEns_src.end(); ++ens_it) {
+      for (vector<ExSource>::iterator it = ens_it->begin(); it != ens_it->end(); ++it) {
+         it->init();
+      }
+   }
+   std::swap(rand_stream(), gEns_rand);
+
+   tEvlt_step = 0;
+
+   simu_state = true;
+
+   cfg_str.clear();
+
+   cfg_str = Simulation::print();
+
+   if (synp_store() == SYNP_STORE_TABLE) {
+      cout << "INFO: sparse connection list has " << conn_num() << " entries ("
+         << 100. * conn_num() / (static_cast<TReal>(gNG_num) * gElmt_num * gElmt_num * SPK_PATH_NUM)
+         << "% of all pathways) in " << bkt_num() << " delay buckets, which use "
+         << (static_cast<TReal>(conn_num()) * (sizeof(TInt) + sizeof(TReal)) 
+            + (2. * bkt_num() + 1. + gNG_num * gElmt_num + 1.) * sizeof(TInt)) / 1048576. << " MB.\n";
+   }
+   else {
+      cout << "INFO: translation-invariant stencils have " << stcl_num() << " pathways ("
+         << 100. * stcl_num() / (static_cast<TReal>(gNG_num) * gElmt_num * SPK_PATH_NUM)
+         << "% of all pathways), synapse ratio kernels use "
+         << static_cast<TReal>(gNG_num) * gElmt_num * SPK_PATH_NUM * sizeof(TReal) / 1048576. << " MB.\n";
+   }
+
+   const size_t psp_byte = (gPSP.empty() ? 0 : sizeof(TReal)) + (gPSP_sp.empty() ? 0 : sizeof(TFloat));
+   cout << "INFO: PSP rings of the groups hold " << *std::min_element(gPSP_ring.begin(), gPSP_ring.end()) << " to "
+      << gPSP_slot_num << " steps (" << nextpow2(max_elmt_delay + max_spk_delay + gBlock_step) << " to the farthest element), "
+      << "PSP history uses " << gPSP_off[gNG_num] * psp_byte / 1048576. << " MB, "
+      << (psp_full - gPSP_off[gNG_num]) * psp_byte / 1048576. << " MB less.\n";
+
+   if (fire_tol() > 0.) {
+      TInt fire_num = 0;
+      TReal fire_err = 0.;
+      for (vector<NeurGrp>::const_iterator ng_it = gNeur.begin(); ng_it != gNeur.end(); ++ng_it) {
+         fire_num = std::max(fire_num, ng_it->fire_table_size());
+         fire_err = std::max(fire_err, ng_it->fire_table_error());
+      }
+      cout << "INFO: firing functions are interpolated from tables of up to " << fire_num 
+         << " intervals, the largest error is " << fire_err << " of FIRE_MAX.\n";
+   }
+
+   if (gKernel != KERNEL_TABLE) {
+      cout << "INFO: recursive receptor kernels deviate from the PSP time courses by at most " << iir_dev
+         << " of the peak and include a tail of up to " << 100. * iir_tail << "% cut by them, the voltage ring has "
+         << gVolt_slot_num << " slots (" << nextpow2(max_psp_size + max_psp_delay + 1) << " with the time courses), states use "
+         << gIIR.size() * sizeof(TReal) / 1048576. << " MB.\n";
+   }
+
+   if (gFar_radius > 0.) {
+      cout << "INFO: far field beyond " << gFar_radius << " mm sums " << gFar_conn << " entries ("
+         << 100. * gFar_conn / std::max(static_cast<TReal>(conn_num()), 1.) << "% of the list) as " << gFar_tap
+         << " taps on blocks of " << gFar_block << "x" << gFar_block << " elements, the input of a row deviates by up to "
+         << gFar_dev << " of its amplitude on the test waves.\n";
+   }
+
+   if (gSymm) {
+      cout << "INFO: homogeneous run is reduced to one column standing for the " << gElmt_num 
+         << " elements, its rows sum " << gSymm_conn << " entries into " << conn_num() << " delay buckets.\n";
+   }
+
+   if (gEns_num > 1) {
+      cout << "INFO: ensemble of " << gEns_num << " members shares the connections, histories use "
+         << (gPSP.size() * sizeof(TReal) + gVolt.size() * sizeof(TReal)) / 1048576. << " MB.\n";
+   }
+
+   if (gProc_num > 1) {
+      cout << "INFO: process " << proc_rank() << " of " << gProc_num << " (" << gTrans->name() << ") owns "
+         << gElmt_own << " elements and receives a halo of " << gElmt_col - gElmt_own << " elements.\n";
+   }
+
+   if (gEngine == ENGINE_SPARSE) {
+      cout << "INFO: connection gather uses the " << Gather::name(gGather.level()) << " kernel in "
+         << (gPrecision == PRECISION_DOUBLE ? "double" : (gPrecision == PRECISION_SINGLE ? "single" : "double and single"))
+         << " precision, PSP history uses " 
+         << (gPSP.size() * sizeof(TReal) + gPSP_sp.size() * sizeof(TFloat)) / 1048576. << " MB.\n";
+      cout << "INFO: elements are advanced through up to " << gBlock_step << " steps per synchronisation "
+         << "(at most " << block_step_max() << " allowed by the spike delays).\n";
+   }
+   else if (gEngine == ENGINE_FFT) {
+      cout << "INFO: FFT engine uses " << gFFT_bin_delay.size() << " delay bins and "
+         << gChan_delay.size() << " channels, spectral ring of " << gFFT_ring_size << " steps uses "
+         << (gFFT_ring.size() + gFFT_kern.size()) * sizeof(TComplex) / 1048576. << " MB.\n";
+   }
+   else if (gEngine == ENGINE_SEPARABLE) {
+      cout << "INFO: separable engine uses " << gSep_off.size() << " 1D taps and "
+         << gSep_corr_off.size() << " corrections over " << gNG_num << " neuron groups.\n";
+   }
+   else {
+      cout << "INFO: push engine scatters over " << gPush_tgt.size() << " transposed entries"
+         << (gEngine == ENGINE_AUTO ? " when few sources are active" : "") << ", fields use "
+         << gPush_field.size() * sizeof(TReal) / 1048576. << " MB.\n";
+   }
+
+   cout << "INFO: next check point is " << tCheck_pnt*gStep_size << " msec.\n";
+
+   return true;
+}
+
+//--------------------------------------------------
+// function void Simulation::init_proc(void)
+//   Start the processes of a distributed run, see gProc_num. They are 
+//   forked here, before the thread team is set up, and go through the
+//   rest of the set-up each on its own. The standard output of the 
+//   other processes than the first one is switched off
+//--------------------------------------------------
+void Simulation::init_proc(void)
+{
+   if (gTrans != NULL) {
+      if (gTrans->size() == gProc_num) return;
+      cerr << "ERROR! SIMU.PROC_NUM can not be changed after the processes are started. " << _FILE_LINE_ << endl;
+      exit(-1);
+   }
+
+   if (gProc_num == 1) return;
+
+   gTrans = SocketTransport::spawn(gProc_num);
+   if (gTrans == NULL) {
+      cerr << "ERROR! the " << gProc_num << " processes of SIMU.PROC_NUM can not be started. " << _FILE_LINE_ << endl;
+      exit(-1);
+   }
+
+   if (gTrans->rank() > 0) cout.setstate(std::ios::failbit);
+}
+
+//--------------------------------------------------
+// function void Simulation::init_thread(void)
+//   Set up the thread team: gThread_num threads, or one per physical core
+//   if 0, at most the processors the program may run on. If gThread_pin, 
+//   the threads are bound to the processors given by Topology::place() 
+//   (within the affinity mask the process was started with), so a thread
+//   stays on the node of its elements. The binding is left to the OpenMP
+//   runtime if OMP_PROC_BIND is set
+//--------------------------------------------------
+void Simulation::init_thread(void)
+{
+   gTopo.load();
+   gThread_cpu.clear();
+
+#ifdef _OPENMP
+   //the processes of a distributed run share the cores
+   TInt nthrd = (gThread_num > 0) ? std::min(gThread_num, gTopo.cpu_num()) : std::max(1, gTopo.core_num() / gProc_num);
+
+   omp_set_num_threads(nthrd);
+   omp_set_nested(0);
+   omp_set_dynamic(0); //the team of advance(const TInt&) keeps its size over the steps
+
+   if (gThread_pin == 0 || !gTopo.pinnable() || getenv("OMP_PROC_BIND") != NULL) return;
+
+   if (nthrd * gProc_num > gTopo.cpu_num()) {
+      if (proc_rank() == 0) cerr << "WARNING: " << gProc_num << " processes of " << nthrd << " threads exceed the "
+         << gTopo.cpu_num() << " processors, the threads are not pinned." << endl;
+      return;
+   }
+
+   //a process takes its share of the threads placed for all of them
+   std::vector<TInt> cpus;
+   gTopo.place(nthrd * gProc_num, cpus);
+   gThread_cpu.assign(cpus.begin() + nthrd * proc_rank(), cpus.begin() + nthrd * (proc_rank() + 1));
+
+   TInt fail = 0;
+#pragma omp parallel reduction(+:fail)
+   {
+      if (omp_get_num_threads() != nthrd || !Topology::pin(gThread_cpu[omp_get_thread_num()])) ++fail;
+   }
+
+   if (fail > 0) {
+      cerr << "WARNING: " << fail << " of " << nthrd << " threads can not be pinned, "
+         << "they are left to the system." << endl;
+      gThread_cpu.clear();
+   }
+#endif
+}
+
+//the index of the point (x, y) along the Hilbert curve over a side x side grid,
+//side must be a power of 2
+static TInt hilbert_key(const TInt& side, TInt x, TInt y)
+{
+   TInt key = 0;
+   for (TInt s = side / 2; s > 0; s /= 2) {
+      TInt rx = (x & s) ? 1 : 0;
+      TInt ry = (y & s) ? 1 : 0;
+      key += s * s * ((3 * rx) ^ ry);
+
+      //rotate the quadrant
+      if (ry == 0) {
+         if (rx == 1) {
+            x = side - 1 - x;
+            y = side - 1 - y;
+         }
+         std::swap(x, y);
+      }
+   }
+   return key;
+}
+
+//the index of the point (x, y) along the Morton curve, the bits of x and y interleaved
+static TInt morton_key(const TInt& x, const TInt& y)
+{
+   TInt key = 0;
+   for (TInt bit = 0; (x >> bit) > 0 || (y >> bit) > 0; ++bit) {
+      key |= (((x >> bit) & 1) << (2 * bit)) | (((y >> bit) & 1) << (2 * bit + 1));
+   }
+   return key;
+}
+
+//--------------------------------------------------
+// function bool Simulation::init_order(void)
+//   Set up the order of the elements, see gElmt_order. The elements
+//   are sorted by their index along a space-filling curve over the 
+//   grid (the side rounded up to a power of 2), so that the range of
+//   a thread in a static loop is a compact tile of the grid
+//--------------------------------------------------
+bool Simulation::init_order(void)
+{
+   gElmt_order = gElmt_cfg;
+   if (gElmt_cfg == ORDER_AUTO) {
+      gElmt_order = (gEngine == ENGINE_FFT || gEngine == ENGINE_SEPARABLE) ? ORDER_ROW : ORDER_HILBERT;
+   }
+
+   //the convolutions run over the planes of the grid
+   if (gElmt_order != ORDER_ROW && (gEngine == ENGINE_FFT || gEngine == ENGINE_SEPARABLE)) {
+      cerr << "ERROR! SIMU.ELMT_ORDER = " << gElmt_cfg << " requires SIMU.ENGINE = " << ENGINE_SPARSE
+         << ", " << ENGINE_PUSH << " or " << ENGINE_AUTO << ". " << _FILE_LINE_ << endl;
+      return false;
+   }
+
+   const TInt side = nextpow2(gGrid_row);
+
+   vector<pair<TInt, TInt> > key(gElmt_num); //(key, grid index)
+   for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
+      TInt y = ielmt / gGrid_row;
+      TInt x = ielmt - y * gGrid_row;
+      if (gElmt_order == ORDER_HILBERT) key[ielmt].first = hilbert_key(side, x, y);
+      else if (gElmt_order == ORDER_MORTON) key[ielmt].first = morton_key(x, y);
+      else key[ielmt].first = ielmt;
+      key[ielmt].second = ielmt;
+   }
+   std::sort(key.begin(), key.end());
+
+   gElmt_pos.resize(gElmt_num);
+   gElmt_idx.resize(gElmt_num);
+   gElmtX.resize(gElmt_num);
+   gElmtY.resize(gElmt_num);
+
+   for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
+      gElmt_pos[ielmt] = key[ielmt].second;
+      gElmt_idx[key[ielmt].second] = ielmt;
+      gElmtY[ielmt] = gElmt_pos[ielmt] / gGrid_row;
+      gElmtX[ielmt] = gElmt_pos[ielmt] - gElmtY[ielmt] * gGrid_row;
+   }
+
+   return true;
+}
+
+//--------------------------------------------------
+// function bool Simulation::init_domain(void)
+//   Set up the elements owned by the process, a contiguous range of 
+//   the stored elements (so a compact tile of the grid along the curve 
+//   of gElmt_order), and its halo: the source elements of its targets 
+//   owned by the other processes, found from the connection list (or 
+//   regenerated from the stencils). The processes send each other the 
+//   lists of the elements they need, see exchange_halo()
+//--------------------------------------------------
+bool Simulation::init_domain(void)
+{
+   const TInt rank = proc_rank();
+
+   gElmt_bgn = proc_bgn(rank);
+   gElmt_own = proc_bgn(rank + 1) - gElmt_bgn;
+   gElmt_col = gElmt_own;
+
+   gGrid_col.assign(gElmt_num, -1);
+   for (TInt ielmt = 0; ielmt < gElmt_own; ++ielmt) {
+      gGrid_col[gElmt_pos[gElmt_bgn + ielmt]] = ielmt;
+   }
+
+   gHalo_send.assign(gProc_num, vector<TInt>());
+   gHalo_recv.assign(gProc_num, vector<TInt>());
+
+   if (gProc_num == 1) return true;
+
+   if (gEngine != ENGINE_SPARSE) {
+      cerr << "ERROR! SIMU.PROC_NUM > 1 requires SIMU.ENGINE = " << ENGINE_SPARSE << ". " << _FILE_LINE_ << endl;
+      return false;
+   }
+
+   if (gProc_num > gElmt_num) {
+      cerr << "ERROR! SIMU.PROC_NUM = " << gProc_num << " exceeds the " << gElmt_num << " elements. " << _FILE_LINE_ << endl;
+      return false;
+   }
+
+   //the sources of the owned targets, by stored index
+   vector<bool> need(gElmt_num, false);
+   if (synp_store() == SYNP_STORE_TABLE) {
+      for (TInt ielmt = 0; ielmt < gElmt_own; ++ielmt) {
+         TInt o_elmt = gElmt_pos[gElmt_bgn + ielmt];
+         for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+            TInt o_row = CONN_ROW_IDX(ineur, o_elmt);
+            for (TInt iconn = gBkt_bgn[gConn_ptr[o_row]]; iconn < gBkt_bgn[gConn_ptr[o_row + 1]]; ++iconn) {
+               need[gElmt_idx[gConn_src[iconn]]] = true;
+            }
+         }
+      }
+   }
+   else {
+      const TInt row_max = conn_row_max();
+      vector<TInt> src(row_max), bkt_bgn(row_max + 1), bkt_delay(row_max);
+      vector<TReal> pct(row_max);
+      for (TInt ielmt = 0; ielmt < gElmt_own; ++ielmt) {
+         TInt o_elmt = gElmt_pos[gElmt_bgn + ielmt];
+         for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+            TInt bkt_num = conn_row(ineur, o_elmt, src.data(), pct.data(), bkt_bgn.data(), bkt_delay.data());
+            for (TInt iconn = 0; iconn < bkt_bgn[bkt_num]; ++iconn) {
+               need[gElmt_idx[src[iconn]]] = true;
+            }
+         }
+      }
+   }
+
+   //the halo columns by owner, in the order of the stored elements on both sides
+   vector<vector<char> > send(gProc_num), recv;
+   TInt iproc = 0;
+   for (TInt s_elmt = 0; s_elmt < gElmt_num; ++s_elmt) {
+      while (s_elmt >= proc_bgn(iproc + 1)) ++iproc;
+      if (!need[s_elmt] || iproc == rank) continue;
+
+      gGrid_col[gElmt_pos[s_elmt]] = gElmt_col;
+      gHalo_recv[iproc].push_back(gElmt_col++);
+
+      const char *pos = reinterpret_cast<const char*>(&s_elmt);
+      send[iproc].insert(send[iproc].end(), pos, pos + sizeof(TInt));
+   }
+
+   if (!gTrans->exchange(send, recv)) {
+      cerr << "ERROR! the halos can not be set up. " << _FILE_LINE_ << endl;
+      return false;
+   }
+
+   for (iproc = 0; iproc < gProc_num; ++iproc) {
+      const TInt *s_elmt = reinterpret_cast<const TInt*>(recv[iproc].data());
+      for (TInt idx = 0; idx < recv[iproc].size() / sizeof(TInt); ++idx) {
+         gHalo_send[iproc].push_back(s_elmt[idx] - gElmt_bgn);
+      }
+   }
+
+   return true;
+}
+
+//--------------------------------------------------
+// function bool Simulation::init_symm(void)
+//   Reduce a spatially homogeneous run to one column (gSymm). On the 
+//   torus the synapse ratios without jitter only depend on the 
+//   displacement, so if every element gets the same input from the 
+//   external sources and starts at rest, all the elements have the 
+//   same membrane potentials at every step. The first stored element 
+//   is then the only column: its rows are summed into one entry per 
+//   delay bucket (the sum of the ratios on its own column), which 
+//   place_conn() copies like the connection list, and the other 
+//   elements read its values when the data are written. The external 
+//   input only reaches the column through its own grid index
+//--------------------------------------------------
+bool Simulation::init_symm(void)
+{
+   gSymm = false;
+   gSymm_conn = 0;
+
+   if (gSymm_cfg == SYMM_OFF) return true;
+
+   string reason = symm_broken();
+   if (reason.empty()) {
+      if (gEngine != ENGINE_SPARSE) reason = "it requires SIMU.ENGINE = " + int2str(ENGINE_SPARSE);
+      else if (gProc_num > 1) reason = "it requires SIMU.PROC_NUM = 1";
+      else if (gFar_radius > 0.) reason = "it requires SIMU.FAR_RADIUS = 0";
+   }
+
+   if (!reason.empty()) {
+      if (gSymm_cfg == SYMM_ON) {
+         cerr << "ERROR! SIMU.SYMMETRY = " << SYMM_ON << ": the run can not be reduced to one column, " 
+            << reason << ". " << _FILE_LINE_ << endl;
+         return false;
+      }
+      return true;
+   }
+
+   gSymm = true;
+
+   if (gSymm_cfg == SYMM_AUTO) {
+      cerr << "WARNING: SIMU.SYMMETRY = " << SYMM_AUTO << ": the run is found to be homogeneous and is reduced "
+         << "to one column, set SIMU.SYMMETRY = " << SYMM_OFF << " to advance every element." << endl;
+   }
+
+   const TInt o_elmt = gElmt_pos[0];
+   gElmt_bgn = 0;
+   gElmt_own = 1;
+   gElmt_col = 1;
+   gGrid_col.assign(gElmt_num, -1);
+   gGrid_col[o_elmt] = 0;
+
+   //the rows of the column, one entry per bucket on the column itself
+   std::vector<TInt> ptr(gNG_num * gElmt_num + 1, 0), src, bkt_bgn(1, 0), bkt_delay;
+   std::vector<TReal> pct;
+
+   const TInt row_max = (synp_store() == SYNP_STORE_KERNEL) ? conn_row_max() : 0;
+   std::vector<TInt> row_src(row_max), row_bkt_bgn(row_max + 1), row_bkt_delay(row_max);
+   std::vector<TReal> row_pct(row_max);
+
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      TInt o_row = CONN_ROW_IDX(ineur, o_elmt);
+      TInt bkt_prev = bkt_delay.size();
+
+      const TInt *r_bkt_bgn, *r_bkt_delay;
+      const TReal *r_pct;
+      TInt bkt_first, bkt_last;
+      if (synp_store() == SYNP_STORE_TABLE) {
+         r_bkt_bgn = gBkt_bgn.data();
+         r_bkt_delay = gBkt_delay.data();
+         r_pct = gConn_pct.data();
+         bkt_first = gConn_ptr[o_row];
+         bkt_last = gConn_ptr[o_row + 1];
+      }
+      else {
+         r_bkt_bgn = row_bkt_bgn.data();
+         r_bkt_delay = row_bkt_delay.data();
+         r_pct = row_pct.data();
+         bkt_first = 0;
+         bkt_last = conn_row(ineur, o_elmt, row_src.data(), row_pct.data(), row_bkt_bgn.data(), row_bkt_delay.data());
+      }
+
+      for (TInt ibkt = bkt_first; ibkt < bkt_last; ++ibkt) {
+         TReal wsum = 0.;
+         for (TInt iconn = r_bkt_bgn[ibkt]; iconn < r_bkt_bgn[ibkt + 1]; ++iconn) {
+            wsum += r_pct[iconn];
+         }
+         gSymm_conn += r_bkt_bgn[ibkt + 1] - r_bkt_bgn[ibkt];
+
+         src.push_back(o_elmt);
+         pct.push_back(wsum);
+         bkt_delay.push_back(r_bkt_delay[ibkt]);
+         bkt_bgn.push_back(src.size());
+      }
+
+      //the rows of the other elements are empty
+      for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) {
+         ptr[CONN_ROW_IDX(ineur, t_elmt) + 1] = (t_elmt < o_elmt) ? bkt_prev : bkt_delay.size();
+      }
+   }
+
+   gConn_ptr.assign(ptr.begin(), ptr.end());
+   gConn_src.assign(src.begin(), src.end());
+   gConn_pct.assign(pct.begin(), pct.end());
+   gBkt_bgn.assign(bkt_bgn.begin(), bkt_bgn.end());
+   gBkt_delay.assign(bkt_delay.begin(), bkt_delay.end());
+
+   return true;
+}
+
+//--------------------------------------------------
+// function string Simulation::symm_broken(void) const
+//   The elements get the same input if the synapse ratios have no 
+//   jitter and every stimulator reaches all the elements with the 
+//   same afferent (ST_GAUSS or ST_SYNC_NOISE). The initial state and
+//   the synapses of the groups and the sources are the same for all 
+//   the elements anyway
+//--------------------------------------------------
+string Simulation::symm_broken(void) const
+{
+   if (synp_jitter_sd() != 0.) return "LCM.SYNP_JITTER is not zero";
+
+   for (vector<ExSource>::const_iterator es_it = gExSrc.begin(); es_it != gExSrc.end(); ++es_it) {
+      for (TInt istim = 0; istim < es_it->stim_num(); ++istim) {
+         const Stimulator& st = es_it->stim(istim);
+         if (st.mode() != ST_GAUSS && st.mode() != ST_SYNC_NOISE) {
+            return "the stimulator " + st.name() + " draws a noise for every element";
+         }
+
+         vector<bool> hit(gElmt_num, false);
+         TInt hit_num = 0;
+         for (vector<TInt>::const_iterator it = st.elmt_list().begin(); it != st.elmt_list().end(); ++it) {
+            if (*it < 0 || *it >= gElmt_num || hit[*it]) continue;
+            hit[*it] = true;
+            ++hit_num;
+         }
+         if (hit_num < gElmt_num) {
+            return "the stimulator " + st.name() + " does not reach all the elements";
+         }
+      }
+   }
+
+   return "";
+}
+
+//--------------------------------------------------
+// function void Simulation::place_conn(void)
+//   Copy the connection list (SYNP_STORE_TABLE) to new pages, the 
+//   rows of a target element are written by the thread gathering 
+//   its input (the loop of advance_sparse()), so the pages are 
+//   placed on the NUMA node of the thread (first touch). The rows 
+//   and the sources are moved to the order of the elements (the 
+//   entries of a bucket keep their order), and the ratios in single
+//   precision (gPrecision) and the sums of the buckets (activity 
+//   gating and the push) are made on the way. Only the rows of the 
+//   elements owned by the process are kept, the sources are the 
+//   columns of its PSP planes, see init_domain()
+//--------------------------------------------------
+void Simulation::place_conn(void)
+{
+   std::vector<TInt, TouchAllocator<TInt> > ptr, src, bkt_bgn, bkt_delay;
+   std::vector<TReal, TouchAllocator<TReal> > pct, bkt_wsum;
+
+   const bool sp_flg = (gPrecision != PRECISION_DOUBLE);
+   const bool wsum_flg = (gGate_eps > 0. || gEngine == ENGINE_PUSH || gEngine == ENGINE_AUTO);
+
+   //the first bucket and entry of a row in the order of the elements
+   const TInt row_num = gConn_ptr.size() - 1;
+   vector<TInt> row_bkt(row_num + 1, 0), row_conn(row_num + 1, 0);
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) {
+         TInt o_elmt = gElmt_pos[t_elmt];
+         TInt row = CONN_ROW_IDX(ineur, t_elmt);
+         TInt o_row = CONN_ROW_IDX(ineur, o_elmt);
+         bool own = (t_elmt >= gElmt_bgn && t_elmt < gElmt_bgn + gElmt_own);
+         row_bkt[row + 1] = row_bkt[row] + (own ? gConn_ptr[o_row + 1] - gConn_ptr[o_row] : 0);
+         row_conn[row + 1] = row_conn[row] + (own ? gBkt_bgn[gConn_ptr[o_row + 1]] - gBkt_bgn[gConn_ptr[o_row]] : 0);
+      }
+   }
+
+   ptr.resize(gConn_ptr.size());
+   src.resize(row_conn[row_num]);
+   pct.resize(row_conn[row_num]);
+   bkt_bgn.resize(row_bkt[row_num] + 1);
+   bkt_delay.resize(row_bkt[row_num]);
+   gConn_pct_sp.resize(sp_flg ? row_conn[row_num] : 0);
+   bkt_wsum.resize(wsum_flg ? row_bkt[row_num] : 0);
+
+   //the (empty) rows of the elements of the other processes
+   for (TInt ineur = 0; ineur < gNG_num && gElmt_own < gElmt_num; ++ineur) {
+      for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) {
+         if (t_elmt >= gElmt_bgn && t_elmt < gElmt_bgn + gElmt_own) continue;
+         ptr[CONN_ROW_IDX(ineur, t_elmt) + 1] = row_bkt[CONN_ROW_IDX(ineur, t_elmt) + 1];
+      }
+   }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+   for (TInt l_elmt = 0; l_elmt < gElmt_own; ++l_elmt) {
+      TInt t_elmt = gElmt_bgn + l_elmt;
+      TInt o_elmt = gElmt_pos[t_elmt];
+      for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+         TInt row = CONN_ROW_IDX(ineur, t_elmt);
+         TInt o_row = CONN_ROW_IDX(ineur, o_elmt);
+         ptr[row + 1] = row_bkt[row + 1];
+
+         //shifts of the buckets and the entries of the row
+         TInt bkt_off = row_bkt[row] - gConn_ptr[o_row];
+         TInt conn_off = row_conn[row] - gBkt_bgn[gConn_ptr[o_row]];
+
+         for (TInt ibkt = gConn_ptr[o_row]; ibkt < gConn_ptr[o_row + 1]; ++ibkt) {
+            bkt_bgn[ibkt + bkt_off + 1] = gBkt_bgn[ibkt + 1] + conn_off;
+            bkt_delay[ibkt + bkt_off] = gBkt_delay[ibkt];
+
+            TReal wsum = 0.;
+            for (TInt iconn = gBkt_bgn[ibkt]; iconn < gBkt_bgn[ibkt + 1]; ++iconn) {
+               src[iconn + conn_off] = gGrid_col[gConn_src[iconn]];
+               pct[iconn + conn_off] = gConn_pct[iconn];
+               if (sp_flg) gConn_pct_sp[iconn + conn_off] = static_cast<TFloat>(gConn_pct[iconn]);
+               wsum += gConn_pct[iconn];
+            }
+            if (wsum_flg) bkt_wsum[ibkt + bkt_off] = wsum;
+         }
+      }
+   }
+
+   ptr[0] = 0;
+   bkt_bgn[0] = 0;
+
+   gConn_ptr.swap(ptr);
+   gConn_src.swap(src);
+   gConn_pct.swap(pct);
+   gBkt_bgn.swap(bkt_bgn);
+   gBkt_delay.swap(bkt_delay);
+   gBkt_wsum.swap(bkt_wsum);
+}
+
+//--------------------------------------------------
+// function bool Simulation::init_far(void)
+//   Set up the far field (gFar_radius > 0) on the connection list
+//   made by place_conn(). The buckets of a row beyond gFar_radius
+//   (by their delay and the spike speed of the group) are the last
+//   ones of the row. Their entries are summed by the block of the
+//   source and by the span of delays of a block (across its
+//   diagonal): a tap holds the sum of the ratios, and the mean delay
+//   weighted by the ratios stands for the delay of the block centre.
+//   The exact entries stay in the list after gFar_near[row]
+//
+//   The taps are checked against the exact entries on test fields:
+//   plane waves of PSP with a wavelength of gFar_radius in four
+//   directions, which move at the spike speed of the group. The 
+//   deviation of the input of a row, relative to its input with all 
+//   the sources at the crest of a wave, must be at most gFar_eps
+//--------------------------------------------------
+bool Simulation::init_far(void)
+{
+   gFar_side = 0;
+   gFar_blk_num = 0;
+   gFar_pad = 0;
+   gFar_blk.clear();
+   gFar_inv.clear();
+   gFar_psp.clear();
+   gFar_near.clear();
+   gFar_ptr.clear();
+   gFar_bkt_bgn.clear();
+   gFar_bkt_delay.clear();
+   gFar_src.clear();
+   gFar_pct.clear();
+   gFar_conn = 0.;
+   gFar_tap = 0.;
+   gFar_dev = 0.;
+
+   if (gFar_radius <= 0.) return true;
+
+   gFar_side = (gGrid_row + gFar_block - 1) / gFar_block;
+   gFar_blk_num = gFar_side * gFar_side;
+   gFar_pad = (gFar_blk_num + ALIGNED_ARRAY_BYTES / sizeof(TFloat) - 1) / (ALIGNED_ARRAY_BYTES / sizeof(TFloat))
+      * (ALIGNED_ARRAY_BYTES / sizeof(TFloat));
+
+   //the blocks of the columns (the stored elements, see gProc_num)
+   gFar_blk.resize(gElmt_col);
+   gFar_inv.assign(gFar_blk_num, 0.);
+   for (TInt icol = 0; icol < gElmt_col; ++icol) {
+      gFar_blk[icol] = gElmtX[icol] / gFar_block + gFar_side * (gElmtY[icol] / gFar_block);
+      gFar_inv[gFar_blk[icol]] += 1.;
+   }
+   for (TInt iblk = 0; iblk < gFar_blk_num; ++iblk) {
+      gFar_inv[iblk] = (gFar_inv[iblk] > 0.) ? 1. / gFar_inv[iblk] : 0.;
+   }
+
+   //the test waves over the grid, exp(i*phase) of a column and its mean over a block
+   const TInt wave_num = 4;
+   TInt n_wave = static_cast<TInt>(gGrid_row * gElmt_size / gFar_radius + 0.5);
+   n_wave = std::min(std::max(n_wave, 1), std::max(gGrid_row / 2, 1));
+   const TInt wave_x[wave_num] = { n_wave, 0, n_wave, n_wave };
+   const TInt wave_y[wave_num] = { 0, n_wave, n_wave, -n_wave };
+
+   vector<TComplex> wave_col(static_cast<size_t>(wave_num) * gElmt_col);
+   vector<TComplex> wave_blk(static_cast<size_t>(wave_num) * gFar_blk_num, TComplex(0., 0.));
+   for (TInt iwave = 0; iwave < wave_num; ++iwave) {
+      for (TInt icol = 0; icol < gElmt_col; ++icol) {
+         TReal phase = 2. * M_PI * (wave_x[iwave] * gElmtX[icol] + wave_y[iwave] * gElmtY[icol]) / gGrid_row;
+         wave_col[icol + gElmt_col * iwave] = std::polar(1., phase);
+         wave_blk[gFar_blk[icol] + gFar_blk_num * iwave] += wave_col[icol + gElmt_col * iwave] * gFar_inv[gFar_blk[icol]];
+      }
+   }
+
+   const TInt row_num = gConn_ptr.size() - 1;
+   gFar_near.resize(row_num);
+   gFar_ptr.assign(row_num + 1, 0);
+   gFar_bkt_bgn.assign(1, 0);
+
+   vector<pair<pair<TInt, TInt>, pair<TInt, TReal> > > item; //((delay span, block), (delay, ratio))
+   vector<pair<TInt, pair<TInt, TReal> > > tap;               //(delay, (block, ratio))
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      const NeurGrp &ng = gNeur[ineur];
+      const TReal far_delay = gFar_radius / (ng.spk_speed() * gStep_size);
+      const TInt span = std::max(1, static_cast<TInt>(std::ceil(gFar_block * M_SQRT2 * gElmt_size / (ng.spk_speed() * gStep_size))));
+
+      //the wave moves by a wavelength in the time a spike takes for it
+      TReal omega[wave_num];
+      for (TInt iwave = 0; iwave < wave_num; ++iwave) {
+         omega[iwave] = 2. * M_PI * ng.spk_speed() * gStep_size
+            * std::sqrt(1. * wave_x[iwave] * wave_x[iwave] + wave_y[iwave] * wave_y[iwave]) / (gGrid_row * gElmt_size);
+      }
+
+      for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) {
+         const TInt row = CONN_ROW_IDX(ineur, t_elmt);
+
+         TInt near = gConn_ptr[row];
+         while (near < gConn_ptr[row + 1] && gBkt_delay[near] <= far_delay) ++near;
+         gFar_near[row] = near;
+
+         item.clear();
+         for (TInt ibkt = near; ibkt < gConn_ptr[row + 1]; ++ibkt) {
+            for (TInt iconn = gBkt_bgn[ibkt]; iconn < gBkt_bgn[ibkt + 1]; ++iconn) {
+               item.push_back(make_pair(make_pair(gBkt_delay[ibkt] / span, gFar_blk[gConn_src[iconn]]),
+                  make_pair(gBkt_delay[ibkt], gConn_pct[iconn])));
+            }
+         }
+         std::sort(item.begin(), item.end());
+
+         tap.clear();
+         for (size_t i = 0, j; i < item.size(); i = j) {
+            TReal w = 0., wd = 0.;
+            for (j = i; j < item.size() && item[j].first == item[i].first; ++j) {
+               w += item[j].second.second;
+               wd += item[j].second.second * item[j].second.first;
+            }
+            tap.push_back(make_pair(static_cast<TInt>(wd / w + 0.5), make_pair(item[i].first.second, w)));
+         }
+         std::sort(tap.begin(), tap.end());
+
+         for (size_t itap = 0; itap < tap.size(); ++itap) {
+            if (itap == 0 || tap[itap].first != tap[itap - 1].first) {
+               gFar_bkt_delay.push_back(tap[itap].first);
+               gFar_bkt_bgn.push_back(0);
+            }
+            gFar_src.push_back(tap[itap].second.first);
+            gFar_pct.push_back(tap[itap].second.second);
+            gFar_bkt_bgn.back() = gFar_src.size();
+         }
+         gFar_ptr[row + 1] = gFar_bkt_delay.size();
+
+         gFar_conn += item.size();
+         gFar_tap += tap.size();
+
+         //the exact entries and the taps on the test waves, relative to the input 
+         //of the row if all the sources were at the crest of a wave
+         TReal row_wsum = 0.;
+         for (TInt iconn = gBkt_bgn[gConn_ptr[row]]; iconn < gBkt_bgn[gConn_ptr[row + 1]]; ++iconn) {
+            row_wsum += gConn_pct[iconn];
+         }
+         for (TInt iwave = 0; iwave < wave_num && !item.empty(); ++iwave) {
+            TComplex exact(0., 0.), coarse(0., 0.);
+            for (TInt ibkt = near; ibkt < gConn_ptr[row + 1]; ++ibkt) {
+               TComplex e_bkt(0., 0.);
+               for (TInt iconn = gBkt_bgn[ibkt]; iconn < gBkt_bgn[ibkt + 1]; ++iconn) {
+                  e_bkt += gConn_pct[iconn] * wave_col[gConn_src[iconn] + gElmt_col * iwave];
+               }
+               exact += e_bkt * std::polar(1., omega[iwave] * gBkt_delay[ibkt]);
+            }
+            for (size_t itap = 0; itap < tap.size(); ++itap) {
+               coarse += tap[itap].second.second * wave_blk[tap[itap].second.first + gFar_blk_num * iwave]
+                  * std::polar(1., omega[iwave] * tap[itap].first);
+            }
+            gFar_dev = std::max(gFar_dev, std::abs(exact - coarse) / row_wsum);
+         }
+      }
+   }
+
+   if (gFar_dev > gFar_eps) {
+      cerr << "ERROR! SIMU.FAR_RADIUS = " << gFar_radius << ": the blocks of " << gFar_block << " elements change the input "
+         << "of a row by up to " << gFar_dev << " of its amplitude (SIMU.FAR_EPS = " << gFar_eps << "), the radius is too "
+         << "small or the blocks too large. " << _FILE_LINE_ << endl;
+      return false;
+   }
+
+   //the rings are filled with zero PSP
+   gFar_psp.resize(static_cast<size_t>(gPSP_slot_num) * gNG_num * gPSP_rcpt_num * gFar_pad, 0.);
+
+   return true;
+}
+
+//--------------------------------------------------
+// function bool Simulation::begin_step(void)
+//   Start a new step, see Simulation::advance()
+//--------------------------------------------------
+bool Simulation::begin_step(void)
+{
+   ++tEvlt_step;
+
+   tOut_flg = false;
+
+   if (tEvlt_step > gTotal_step) return false;
+
+   for (vector<TTimeWin>::iterator it = output_time.begin(); it != output_time.end(); ++it) {
+      if (tEvlt_step > it->end_step) {
+         it = output_time.erase(it); //it will point to the next data
+         --it; //even if it==output_time.begin(), operation --it will not throw any exception
+         continue;
+      }
+      else if (tEvlt_step >= (it->bgn_step)) {
+         if ((tEvlt_step - (it->bgn_step)) % (it->inc_step) == 0) {
+            tOut_flg = true;
+         }
+         break;
+      }
+   }
+
+   //calculate next check point
+   if (tEvlt_step == tCheck_pnt) {
+      TInt tmp;
+      tCheck_pnt = MAX_INT_NUM;
+      for (TInt iens = 0; iens < gEns_num; ++iens) {
+         //the stimulators draw new seeds when started, those of the other members of 
+         //the ensemble from gEns_rand, so the first member is the same as a run on its own
+         if (iens == 1) std::swap(rand_stream(), gEns_rand);
+         for (TInt isrc = 0; isrc < gExSrc.size(); ++isrc) {
+            tmp = ens_src(iens, isrc).check(tEvlt_step); //update the state of stimulators
+            if (tCheck_pnt > tmp) tCheck_pnt = tmp;
+         }
+      }
+      if (gEns_num > 1) std::swap(rand_stream(), gEns_rand);
+      if (tCheck_pnt != MAX_INT_NUM) {
+         cout << "INFO: current simulation time=" << evlt_time() << " msec, " \
+            "next check point=" << tCheck_pnt*gStep_size << " msec." << endl;
+      }
+   }
+
+   return true;
+}
+
+//--------------------------------------------------
+// function void Simulation::advance(void)
+// The function advances the stimulation for a time step 
+//--------------------------------------------------
+void Simulation::advance(void)
+{
+
+   assert(simu_state); // Simulation::advance: the model is not ready!
+
+   if (!begin_step()) return;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+   step_team();
+}
+
+//--------------------------------------------------
+// function TInt Simulation::advance(const TInt& max_step)
+//   Advance the simulation by up to max_step steps. 
+//
+//   All the steps of a call are run by one thread team, which 
+//   only waits at the barriers between the parts of a step, so 
+//   the threads are not forked and joined in every step, and 
+//   keep their elements (the loops are scheduled statically).
+//   The step numbers and the stimulators are updated by the 
+//   master thread, see begin_block()
+//
+//   With ENGINE_SPARSE the steps are run in blocks: the spikes of an 
+//   element reach the other elements after at least LCM::block_step_max() 
+//   steps, so within a block every element only depends on itself and 
+//   on the PSP written before the block, and the elements are advanced 
+//   through all the steps of the block in one parallel loop, see 
+//   advance_sparse(). The PSP ring holds gBlock_step - 1 more slots, 
+//   so the slots written in a block are not read in it by the other
+//   elements. The input of the external sources does not depend on 
+//   the model, and is generated for the block in advance. 
+//
+//   The result is the same as that of advance() step by step
+//--------------------------------------------------
+TInt Simulation::advance(const TInt& max_step)
+{
+   assert(simu_state); // Simulation::advance: the model is not ready!
+
+   TInt bgn_step = tEvlt_step;
+
+   tTeam_stop = std::min(tEvlt_step + max_step, gTotal_step);
+
+   if (tTeam_stop - tEvlt_step <= 1) {
+      advance();
+      return 1;
+   }
+
+   tOut_flg = false;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+   {
+      for (;;) {
+         //on the master thread, the stimulators draw from its random stream when activated
+#ifdef _OPENMP
+#pragma omp master
+#endif
+         begin_block();
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+
+         //tTeam_step is not written before the next begin_block(), which follows a barrier
+         if (tTeam_step == 0) break;
+
+         if (tTeam_block) {
+            advance_sparse(tTeam_step);
+#ifdef _OPENMP
+#pragma omp single
+#endif
+            end_block();
+         }
+         else {
+            step_team();
+         }
+      }
+   } //end of OpenMP parallel section
+
+   return tEvlt_step - bgn_step;
+}
+
+//--------------------------------------------------
+// function void Simulation::begin_block(void)
+//   Start (on the master thread) the next block of advance(const TInt&) and set tTeam_step 
+//   to its number of steps, or to 0 if the call has reached tTeam_stop 
+//   or a step to be output. A block of ENGINE_SPARSE (tTeam_block) 
+//   generates the input of the external sources for its steps
+//--------------------------------------------------
+void Simulation::begin_block(void)
+{
+   tTeam_step = 0;
+   tTeam_block = false;
+
+   //the data of the previous step are read after the call
+   if (tEvlt_step >= tTeam_stop || tOut_flg) return;
+
+   TInt nstep = std::min(gBlock_step, tTeam_stop - tEvlt_step);
+
+   if (nstep <= 1) {
+      begin_step();
+      tTeam_step = 1;
+      return;
+   }
+
+   gBlock_phi.assign(static_cast<size_t>(nstep) * gExSrc.size() * gElmt_own * gEns_num, 0.);
+
+   for (TInt istep = 0; istep < nstep; ++istep) {
+      begin_step();
+
+      for (TInt isrc = 0; isrc < gExSrc.size(); ++isrc) {
+         for (TInt iens = 0; iens < gEns_num; ++iens) {
+            ExSource &es = ens_src(iens, isrc);
+            if (es.act_stim_num() == 0) continue;
+
+            for (TInt idx = 0; idx < es.elmt_num(); ++idx) {
+               TReal phi = es.generate(idx) * gEns_scale[iens];
+               TInt t_elmt = gGrid_col[es.get_elmt(idx)];
+               if (t_elmt >= 0 && t_elmt < gElmt_own) gBlock_phi[BLOCK_PHI_IDX(istep, isrc, t_elmt + gElmt_own * iens)] = phi;
+            }
+            es.advance();
+         }
+      }
+
+      //the data of this step are read after the block
+      if (tOut_flg) {
+         nstep = istep + 1;
+         break;
+      }
+   }
+
+   tTeam_step = nstep;
+   tTeam_block = true;
+}
+
+//--------------------------------------------------
+// function void Simulation::end_block(void)
+//   Move the rings over the steps of a block, see begin_block()
+//--------------------------------------------------
+void Simulation::end_block(void)
+{
+   if (gTrans) exchange_halo((tPSP_front + tTeam_step) & (gPSP_slot_num - 1), tTeam_step);
+
+   if (gGate_eps > 0.) {
+      for (TInt istep = 0; istep < tTeam_step; ++istep) {
+         gate_psp((tPSP_front + istep + 1) & (gPSP_slot_num - 1));
+      }
+   }
+
+   if (gFar_radius > 0.) {
+      for (TInt istep = 0; istep < tTeam_step; ++istep) {
+         far_psp((tPSP_front + istep + 1) & (gPSP_slot_num - 1));
+      }
+   }
+
+   tPSP_front = (tPSP_front + tTeam_step) & (gPSP_slot_num - 1);
+   tVolt_rear = (tVolt_rear + tTeam_step) & (gVolt_slot_num - 1);
+}
+
+//--------------------------------------------------
+// function void Simulation::exchange_halo(const TInt& psp_front, const TInt& nstep)
+//   Send the PSP of the nstep slots up to psp_front of the owned 
+//   elements in the halos of the other processes, and write those 
+//   received to the halo columns. A message holds the columns of 
+//   gHalo_send/gHalo_recv for every slot, group and receptor in turn, 
+//   in both precisions if both are kept
+//--------------------------------------------------
+void Simulation::exchange_halo(const TInt& psp_front, const TInt& nstep)
+{
+   const size_t val_size = (gPSP.empty() ? 0 : sizeof(TReal)) + (gPSP_sp.empty() ? 0 : sizeof(TFloat));
+
+   TInt plane_num = 0; //group/receptor planes of a slot
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      plane_num += (gNeur[ineur].type() == cEXCIT) ? gRcpt_excit.size() : gRcpt_inhib.size();
+   }
+
+   vector<vector<char> > send(gProc_num), recv;
+   for (TInt iproc = 0; iproc < gProc_num; ++iproc) {
+      const vector<TInt> &col = gHalo_send[iproc];
+      send[iproc].resize(static_cast<size_t>(nstep) * plane_num * col.size() * val_size);
+
+      char *pos = send[iproc].data();
+      for (TInt eps = 0; eps < nstep; ++eps) {
+         TInt islot = PSP_SLOT_AT(psp_front, eps);
+         for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+            TInt rcpt_num = (gNeur[ineur].type() == cEXCIT) ? gRcpt_excit.size() : gRcpt_inhib.size();
+            for (TInt ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+               for (TInt icol = 0; icol < col.size(); ++icol) {
+                  size_t idx = PSP_IDX(islot, ineur, ircpt, col[icol]);
+                  if (!gPSP.empty()) {
+                     memcpy(pos, &gPSP[idx], sizeof(TReal));
+                     pos += sizeof(TReal);
+                  }
+                  if (!gPSP_sp.empty()) {
+                     memcpy(pos, &gPSP_sp[idx], sizeof(TFloat));
+                     pos += sizeof(TFloat);
+                  }
+               }
+            }
+         }
+      }
+   }
+
+   if (!gTrans->exchange(send, recv)) {
+      cerr << "ERROR! the halo of process " << proc_rank() << " can not be received. " << _FILE_LINE_ << endl;
+      exit(-1);
+   }
+
+   for (TInt iproc = 0; iproc < gProc_num; ++iproc) {
+      const vector<TInt> &col = gHalo_recv[iproc];
+      if (recv[iproc].size() != static_cast<size_t>(nstep) * plane_num * col.size() * val_size) {
+         cerr << "ERROR! the halo from process " << iproc << " has " << recv[iproc].size() 
+            << " bytes, which does not match its columns. " << _FILE_LINE_ << endl;
+         exit(-1);
+      }
+
+      const char *pos = recv[iproc].data();
+      for (TInt eps = 0; eps < nstep; ++eps) {
+         TInt islot = PSP_SLOT_AT(psp_front, eps);
+         for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+            TInt rcpt_num = (gNeur[ineur].type() == cEXCIT) ? gRcpt_excit.size() : gRcpt_inhib.size();
+            for (TInt ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+               for (TInt icol = 0; icol < col.size(); ++icol) {
+                  size_t idx = PSP_IDX(islot, ineur, ircpt, col[icol]);
+                  if (!gPSP.empty()) {
+                     memcpy(&gPSP[idx], pos, sizeof(TReal));
+                     pos += sizeof(TReal);
+                  }
+                  if (!gPSP_sp.empty()) {
+                     memcpy(&gPSP_sp[idx], pos, sizeof(TFloat));
+                     pos += sizeof(TFloat);
+                  }
+               }
+            }
+         }
+      }
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::init_step_buf(void)
+//   Size the buffers of every thread of the team once, so that 
+//   step_team() and advance_sparse() do not allocate them in the steps
+//--------------------------------------------------
+void Simulation::init_step_buf(void)
+{
+   TInt nthrd = 1;
+#ifdef _OPENMP
+   nthrd = omp_get_max_threads();
+#endif
+
+   //rows regenerated from the stencils, see advance_sparse_shape()
+   const bool list_flg = (synp_store() == SYNP_STORE_TABLE || gSymm);
+   const size_t row_size = list_flg ? 0 : static_cast<size_t>(gNG_num) * conn_row_max();
+
+   try {
+      gStep_buf.assign(nthrd, TStepBuf());
+      for (vector<TStepBuf>::iterator it = gStep_buf.begin(); it != gStep_buf.end(); ++it) {
+         it->row.resize(gNG_num);
+         if (!list_flg) {
+            it->row_src.resize(row_size);
+            it->row_pct.resize(row_size);
+            it->row_bkt_bgn.resize(row_size + gNG_num);
+            it->row_bkt_delay.resize(row_size);
+            if (gPrecision != PRECISION_DOUBLE) it->row_pct_sp.resize(row_size);
+            if (gGate_eps > 0.) it->row_bkt_wsum.resize(row_size);
+         }
+         it->scratch.resize(3 * gPSP_rcpt_num);
+         if (gEns_num > 1) it->ens.resize((2 * gPSP_rcpt_num + 1) * gEns_num);
+         it->rcpt_J.resize(gRcpt_excit.size());
+      }
+   }
+   catch (bad_alloc& e) {
+      cerr << msg_allocation_error(e) << endl;
+      exit(-1);
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::step_team(void)
+//   Run the step started by begin_step(), the parts are separated
+//   by the barriers at the end of the worksharing loops
+//--------------------------------------------------
+void Simulation::step_team(void)
+{
+   //eqn_J of the input of an external source, the same for all its synapses
+   TInt ithrd = 0;
+#ifdef _OPENMP
+   ithrd = omp_get_thread_num();
+#endif
+   vector<TReal> &rcpt_J = gStep_buf[ithrd].rcpt_J;
+
+   //the members of the ensemble have the same stimulators, activated at the same steps
+   for (TInt isrc = 0; isrc < gExSrc.size(); ++isrc) {
+      if (gExSrc[isrc].act_stim_num() == 0) continue;
+
+#ifdef _OPENMP //OpenMP options
+#pragma omp for
+#endif
+      for (TInt idx = 0; idx < gExSrc[isrc].elmt_num(); ++idx) {
+         for (TInt iens = 0; iens < gEns_num; ++iens) {
+            ExSource &es = ens_src(iens, isrc);
+            TReal phi = es.generate(idx) * gEns_scale[iens];
+            if (phi == 0) continue;
+
+            TReal tmp_NM;
+            TInt t_elmt = gGrid_col[es.get_elmt(idx)];
+            if (t_elmt < 0 || t_elmt >= gElmt_own) continue; //owned by another process
+            t_elmt += gElmt_own * iens;
+            rcpt_eqn_J(gRcpt_excit, &phi, 1, rcpt_J.data());
+            for (vector<SynpConn>::const_iterator sy_it = es.synp_conn().begin(); sy_it != es.synp_conn().end(); ++sy_it) {
+               tmp_NM = sy_it->weight() * (gV_rev_max - gVolt[VOLT_IDX(t_elmt, sy_it->postsynp(), 0)]);
+               for (TInt ircpt = 0; ircpt < rcpt_J.size(); ++ircpt) {
+                  add2volt(t_elmt, sy_it->postsynp(), gRcpt_excit[ircpt], sy_it->psp_delay(), tmp_NM * rcpt_J[ircpt]);
+               }
+            }
+         }
+      }
+   }
+
+   //the new slot of the PSP rings, which are moved below
+   const TInt psp_front = (tPSP_front + 1) & (gPSP_slot_num - 1);
+
+#ifdef _OPENMP //OpenMP options
+#pragma omp for schedule(static)
+#endif
+   for (TInt ielmt = 0; ielmt < gElmt_own; ++ielmt) {
+      step_psp(ielmt, psp_front, tVolt_rear);
+   }
+
+#ifdef _OPENMP
+#pragma omp single
+#endif
+   {
+      //move all the PSP rings a step forward
+      tPSP_front = psp_front;
+
+      if (gTrans) exchange_halo(tPSP_front, 1);
+
+      if (gGate_eps > 0.) gate_psp(tPSP_front);
+
+      if (gFar_radius > 0.) far_psp(tPSP_front);
+   }
+
+   //synaptic input from the other elements
+   if (gEngine == ENGINE_FFT) {
+      advance_fft();
+      advance_field();
+   }
+   else if (gEngine == ENGINE_SEPARABLE) {
+      advance_sep();
+      advance_field();
+   }
+   else if (gEngine == ENGINE_SPARSE) {
+      advance_sparse(0);
+   }
+   else {
+      advance_push();
+   }
+
+   //calculate the membrane potentials for neuron groups
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+   for (TInt s_elmt = 0; s_elmt < gElmt_own; ++s_elmt) {
+      step_volt(s_elmt, tVolt_rear);
+   }
+
+#ifdef _OPENMP
+#pragma omp single
+#endif
+   {
+      //move all the voltage rings a step forward
+      tVolt_rear = (tVolt_rear + 1) & (gVolt_slot_num - 1);
+
+      //move the stimulator a step forward
+      for (TInt iens = 0; iens < gEns_num; ++iens) {
+         for (TInt isrc = 0; isrc < gExSrc.size(); ++isrc) {
+            if (ens_src(iens, isrc).act_stim_num() == 0) continue;
+            ens_src(iens, isrc).advance(); //prepare the stimulators
+         }
+      }
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::step_psp(const TInt& ielmt, const TInt& psp_front, const TInt& volt_rear)
+//   Write the PSP of the step at psp_front from the membrane potentials
+//   at volt_rear
+//--------------------------------------------------
+void Simulation::step_psp(const TInt& ielmt, const TInt& psp_front, const TInt& volt_rear)
+{
+   TReal phi[ENSEMBLE_MAX], J[ENSEMBLE_MAX];
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+
+      //the firing rates of all the members, see NeurGrp::eqn_firing()
+      gNeur[ineur].eqn_firing(gVolt.data() + VOLT_IDX_AT(volt_rear, ielmt, ineur, 0), 
+         static_cast<size_t>(gElmt_own) * gNG_num * gVolt_slot_num, phi, 1, gEns_num);
+
+      const vector<Receptor> &rcpt = (gNeur[ineur].type() == cEXCIT) ? gRcpt_excit : gRcpt_inhib;
+      for (TInt ircpt = 0; ircpt < rcpt.size(); ++ircpt) {
+         rcpt[ircpt].eqn_J(phi, J, gEns_num);
+         for (TInt iens = 0; iens < gEns_num; ++iens) {
+            set_psp(psp_front, ielmt, ineur, ircpt, J[iens], iens);
+         }
+      }
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::step_volt(const TInt& ielmt, const TInt& volt_rear)
+//   Calculate the membrane potentials of the step after volt_rear
+//--------------------------------------------------
+void Simulation::step_volt(const TInt& ielmt, const TInt& volt_rear)
+{
+   TReal *t_volt;
+   TReal pre_volt, curr_volt, iir_volt, iir_curr;
+   const TInt line = 2 + ((volt_rear + 1) & (gVolt_slot_num - 1)); //the input of the states at the step
+   for (TInt e_elmt = ielmt; e_elmt < gElmt_own * gEns_num; e_elmt += gElmt_own) { //the members of the ensemble
+      for (TInt ineur = 0; ineur < MODEL_NG_NUM; ++ineur) {
+
+         //the PSP of the recursive kernels, A - B summed over the receptors
+         iir_volt = 0.;
+         if (gKernel != KERNEL_TABLE) {
+            TReal *iir = gIIR.data() + IIR_IDX(e_elmt, ineur, 0);
+            for (TInt irslot = 0; irslot < gIIR_rcpt_num; ++irslot, iir += 2 * gVolt_slot_num + 2) {
+               iir[0] = gIIR_a[irslot] * iir[0] + iir[line];
+               iir[1] = gIIR_b[irslot] * iir[1] + iir[line + gVolt_slot_num];
+               iir[line] = 0.;
+               iir[line + gVolt_slot_num] = 0.;
+               iir_volt += iir[0] - iir[1];
+            }
+         }
+
+         //the membrane potential of the states on their own ring, which is compared 
+         //with that of the time courses below, the run goes on with the latter
+         iir_curr = 0.;
+         if (gKernel == KERNEL_VALIDATE) {
+            t_volt = &(gVolt_iir[VOLT_IDX_AT(volt_rear, e_elmt, ineur, 0)]);
+            pre_volt = *t_volt;
+            *t_volt = MODEL_NG(ineur, V_0);
+            t_volt = &(gVolt_iir[VOLT_IDX_AT(volt_rear, e_elmt, ineur, 1)]);
+            curr_volt = (pre_volt - MODEL_NG(ineur, V_0)) * MODEL_NG(ineur, mp_decay_step) + *t_volt + iir_volt;
+            curr_volt = std::min(std::max(curr_volt, gV_rev_min), gV_rev_max);
+            *t_volt = curr_volt;
+
+            iir_curr = curr_volt;
+            iir_volt = 0.;
+         }
+
+         t_volt = &(gVolt[VOLT_IDX_AT(volt_rear, e_elmt, ineur, 0)]);
+
+         pre_volt = *t_volt; //previous step value
+
+         //the slot of the previous step is reused for the farthest future step
+         *t_volt = MODEL_NG(ineur, V_0);
+
+         //current step value is gVolt[VOLT_IDX_AT(volt_rear, e_elmt, ineur, 1)] until the ring is moved
+         t_volt = &(gVolt[VOLT_IDX_AT(volt_rear, e_elmt, ineur, 1)]);
+
+         //(V_(n-1) - V_0) * decay_factor + (V_n -V_0)
+         curr_volt = (pre_volt - MODEL_NG(ineur, V_0)) * MODEL_NG(ineur, mp_decay_step) + \
+            *t_volt + iir_volt;
+
+         if (curr_volt< gV_rev_min) {
+            curr_volt = gV_rev_min;
+         }
+         else if (curr_volt > gV_rev_max) {
+            curr_volt = gV_rev_max;
+         }
+
+         *t_volt = curr_volt;
+
+         if (gKernel == KERNEL_VALIDATE) {
+            gIIR_dev[ielmt] = std::max(gIIR_dev[ielmt], std::abs(iir_curr - curr_volt));
+         }
+      }
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::gate_psp(const TInt& islot)
+//   Record the midpoint and the half range of the PSP of every 
+//   group/receptor over the elements in the slot islot of the PSP 
+//   ring. A delay bucket reading the slot is summed as the midpoint 
+//   times the sum of its ratios, with an error of at most the half 
+//   range times the sum, see gather_synp()
+//--------------------------------------------------
+template <typename T>
+static inline void psp_range(const T* psp, const TInt& num, TReal& lo, TReal& hi)
+{
+   T t_lo = psp[0], t_hi = psp[0];
+   for (TInt ielmt = 1; ielmt < num; ++ielmt) {
+      t_lo = std::min(t_lo, psp[ielmt]);
+      t_hi = std::max(t_hi, psp[ielmt]);
+   }
+   lo = t_lo;
+   hi = t_hi;
+}
+
+void Simulation::gate_psp(const TInt& islot)
+{
+   TReal lo, hi;
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      TInt rcpt_num = (gNeur[ineur].type() == cEXCIT) ? gRcpt_excit.size() : gRcpt_inhib.size();
+      for (TInt ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+         if (!gPSP.empty()) {
+            psp_range(gPSP.data() + PSP_IDX(islot, ineur, ircpt, 0), gElmt_col, lo, hi);
+         }
+         else {
+            psp_range(gPSP_sp.data() + PSP_IDX(islot, ineur, ircpt, 0), gElmt_col, lo, hi);
+         }
+         gGate_mid[GATE_IDX(islot, ineur, ircpt)] = 0.5 * (lo + hi);
+         gGate_dev[GATE_IDX(islot, ineur, ircpt)] = 0.5 * (hi - lo);
+      }
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::far_psp(const TInt& islot)
+//   Record the mean PSP of every block of the grid in the slot
+//   islot of the PSP ring, which the taps of the far field read,
+//   see init_far()
+//--------------------------------------------------
+void Simulation::far_psp(const TInt& islot)
+{
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      TInt rcpt_num = (gNeur[ineur].type() == cEXCIT) ? gRcpt_excit.size() : gRcpt_inhib.size();
+      for (TInt ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+         const TReal *psp = gPSP.data() + PSP_IDX(islot, ineur, ircpt, 0);
+         TReal *blk = gFar_psp.data() + FAR_IDX(islot, ineur, ircpt, 0);
+         std::fill(blk, blk + gFar_blk_num, 0.);
+         for (TInt icol = 0; icol < gElmt_col; ++icol) {
+            blk[gFar_blk[icol]] += psp[icol];
+         }
+         for (TInt iblk = 0; iblk < gFar_blk_num; ++iblk) {
+            blk[iblk] *= gFar_inv[iblk];
+         }
+      }
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::advance_sparse(const TInt& nstep)
+//   Add the synaptic input from the other elements to the 
+//   membrane potentials, by summing over the sparse connection 
+//   list (or the stencils) of every target element. 
+//   The receptors are summed together, so the connections 
+//   are read once per synapse
+//
+//   If nstep == 0, the input of the current step is added. 
+//   Otherwise every element is advanced through nstep whole 
+//   steps, see advance(const TInt&), and the connection rows 
+//   of an element are read (or regenerated) once for the block
+//
+//   It is called by every thread of the team, see advance(const TInt&).
+//   The work is done by advance_sparse_shape<NE, NI>(), which is
+//   instantiated for 1-3 excitatory (NE) and inhibitory (NI) 
+//   receptors, so the receptor loops have constant trip counts.
+//   Other models use the generic version <0, 0>, a model compiled
+//   by lcmc has the version of its own numbers (LCM_MODEL_NE/NI)
+//--------------------------------------------------
+void Simulation::advance_sparse(const TInt& nstep)
+{
+   TInt n_excit = gRcpt_excit.size();
+   TInt n_inhib = gRcpt_inhib.size();
+
+   //the numbers are checked when a compiled model is loaded, see lcmc.cpp
+#ifdef LCM_MODEL_NE
+   advance_sparse_shape<LCM_MODEL_NE, LCM_MODEL_NI>(nstep);
+#else
+
+#define SPARSE_SHAPE_CASE(ne, ni) \
+   if (n_excit == ne && n_inhib == ni) { advance_sparse_shape<ne, ni>(nstep); return; }
+
+   SPARSE_SHAPE_CASE(2, 1) //AMPA + NMDA, GABA_A
+   SPARSE_SHAPE_CASE(1, 1)
+   SPARSE_SHAPE_CASE(1, 2)
+   SPARSE_SHAPE_CASE(1, 3)
+   SPARSE_SHAPE_CASE(2, 2)
+   SPARSE_SHAPE_CASE(2, 3)
+   SPARSE_SHAPE_CASE(3, 1)
+   SPARSE_SHAPE_CASE(3, 2)
+   SPARSE_SHAPE_CASE(3, 3)
+
+#undef SPARSE_SHAPE_CASE
+
+   advance_sparse_shape<0, 0>(nstep);
+#endif
+}
+
+//--------------------------------------------------
+// function void Simulation::advance_sparse_shape<NE, NI>(const TInt& nstep)
+//   See advance_sparse(), NE/NI == 0 means any number of receptors
+//--------------------------------------------------
+template <int NE, int NI>
+void Simulation::advance_sparse_shape(const TInt& nstep)
+{
+   {
+      //the buffers of the thread, see init_step_buf()
+      TInt ithrd = 0;
+#ifdef _OPENMP
+      ithrd = omp_get_thread_num();
+#endif
+      TStepBuf &sb = gStep_buf[ithrd];
+
+      //the rows from all the source groups to a target element
+      std::vector<TConnRow> &row = sb.row;
+
+      //connections regenerated from the stencils (SYNP_STORE_KERNEL only, the
+      //symmetry-reduced run has the summed rows in the list, see init_symm())
+      const bool list_flg = (synp_store() == SYNP_STORE_TABLE || gSymm);
+      std::vector<TInt> &row_src = sb.row_src, &row_bkt_bgn = sb.row_bkt_bgn, &row_bkt_delay = sb.row_bkt_delay;
+      std::vector<TReal> &row_pct = sb.row_pct, &row_bkt_wsum = sb.row_bkt_wsum;
+      std::vector<TFloat> &row_pct_sp = sb.row_pct_sp;
+      const TInt row_max = list_flg ? 0 : conn_row_max();
+
+      //eqn_J of the input of an external source
+      std::vector<TReal> &rcpt_J = sb.rcpt_J;
+
+      TGatherBuf buf;
+      buf.scratch = sb.scratch.data();
+      buf.ens = sb.ens.data();
+      buf.prec_dev = 0.;
+      buf.prec_mag = 0.;
+      buf.gate_skip = 0.;
+      buf.gate_num = 0.;
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (TInt t_elmt = 0; t_elmt < gElmt_own; ++t_elmt) { //loop over the target elements
+
+         //the source elements projecting to the target, grouped by spike delay, see LCM::init()
+         for (TInt s_neur = 0; s_neur < gNG_num; ++s_neur) {
+            TConnRow &r = row[s_neur];
+
+            if (list_flg) {
+               TInt row_idx = CONN_ROW_IDX(s_neur, gElmt_bgn + t_elmt);
+               r.bgn = gConn_ptr[row_idx];
+               r.end = (gFar_radius > 0.) ? gFar_near[row_idx] : gConn_ptr[row_idx + 1];
+               r.far_bgn = (gFar_radius > 0.) ? gFar_ptr[row_idx] : 0;
+               r.far_end = (gFar_radius > 0.) ? gFar_ptr[row_idx + 1] : 0;
+
+               r.src = gConn_src.data();
+               r.pct = gConn_pct.data();
+               r.pct_sp = gConn_pct_sp.data();
+               r.bkt_bgn = gBkt_bgn.data();
+               r.bkt_delay = gBkt_delay.data();
+               r.bkt_wsum = gBkt_wsum.data();
+            }
+            else {
+               size_t off = static_cast<size_t>(s_neur) * row_max;
+
+               r.src = row_src.data() + off;
+               r.pct = row_pct.data() + off;
+               r.pct_sp = row_pct_sp.data() + off;
+               r.bkt_bgn = row_bkt_bgn.data() + off + s_neur;
+               r.bkt_delay = row_bkt_delay.data() + off;
+               r.bkt_wsum = row_bkt_wsum.data() + off;
+
+               r.far_bgn = 0;
+               r.far_end = 0;
+
+               r.bgn = 0;
+               r.end = conn_row(s_neur, gElmt_pos[gElmt_bgn + t_elmt], row_src.data() + off, row_pct.data() + off,
+                  row_bkt_bgn.data() + off + s_neur, row_bkt_delay.data() + off);
+
+               //the sources are regenerated on the grid
+               if (gElmt_order != ORDER_ROW || gTrans) {
+                  for (TInt iconn = 0; iconn < r.bkt_bgn[r.end]; ++iconn) {
+                     row_src[off + iconn] = gGrid_col[row_src[off + iconn]];
+                  }
+               }
+
+               if (gPrecision != PRECISION_DOUBLE) {
+                  for (TInt iconn = 0; iconn < r.bkt_bgn[r.end]; ++iconn) {
+                     row_pct_sp[off + iconn] = static_cast<TFloat>(r.pct[iconn]);
+                  }
+               }
+
+               if (gGate_eps > 0.) {
+                  for (TInt ibkt = 0; ibkt < r.end; ++ibkt) {
+                     row_bkt_wsum[off + ibkt] = 0.;
+                     for (TInt iconn = r.bkt_bgn[ibkt]; iconn < r.bkt_bgn[ibkt + 1]; ++iconn) {
+                        row_bkt_wsum[off + ibkt] += r.pct[iconn];
+                     }
+                  }
+               }
+            }
+         }
+
+         if (nstep == 0) {
+            gather_elmt<NE, NI>(t_elmt, row.data(), tPSP_front, tVolt_rear, 0, buf);
+            continue;
+         }
+
+         //the steps of a block, in the same order as advance()
+         for (TInt istep = 0; istep < nstep; ++istep) {
+            const TInt psp_front = (tPSP_front + istep + 1) & (gPSP_slot_num - 1);
+            const TInt volt_rear = (tVolt_rear + istep) & (gVolt_slot_num - 1);
+
+            //input from the external sources (to every member of the ensemble)
+            for (TInt isrc = 0; isrc < gExSrc.size(); ++isrc) {
+               for (TInt e_elmt = t_elmt; e_elmt < gElmt_own * gEns_num; e_elmt += gElmt_own) {
+                  TReal phi = gBlock_phi[BLOCK_PHI_IDX(istep, isrc, e_elmt)];
+                  if (phi == 0) continue;
+
+                  TReal tmp_NM;
+                  const ExSource &es = gExSrc[isrc];
+                  rcpt_eqn_J(gRcpt_excit, &phi, 1, rcpt_J.data());
+                  for (vector<SynpConn>::const_iterator sy_it = es.synp_conn().begin(); sy_it != es.synp_conn().end(); ++sy_it) {
+                     tmp_NM = sy_it->weight() * (gV_rev_max - gVolt[VOLT_IDX_AT(volt_rear, e_elmt, sy_it->postsynp(), 0)]);
+                     for (TInt ircpt = 0; ircpt < rcpt_J.size(); ++ircpt) {
+                        add2volt(e_elmt, sy_it->postsynp(), gRcpt_excit[ircpt], sy_it->psp_delay(), 
+                           tmp_NM * rcpt_J[ircpt], volt_rear);
+                     }
+                  }
+               }
+            }
+
+            step_psp(t_elmt, psp_front, volt_rear);
+
+            //the ranges of the slots written in the block are not known yet
+            gather_elmt<NE, NI>(t_elmt, row.data(), psp_front, volt_rear, istep + 1, buf);
+
+            step_volt(t_elmt, volt_rear);
+         }
+      } //end of loop for target element      
+
+      if (gPrecision == PRECISION_VALIDATE || gGate_eps > 0.) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+         {
+            gPrec_dev = std::max(gPrec_dev, buf.prec_dev);
+            gPrec_mag = std::max(gPrec_mag, buf.prec_mag);
+            gGate_skip += buf.gate_skip;
+            gGate_num += buf.gate_num;
+         }
+      }
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::gather_elmt<NE, NI>(const TInt& t_elmt, const TConnRow* row, 
+//      const TInt& psp_front, const TInt& volt_rear, const TInt& gate_delay, TGatherBuf& buf)
+//   Add the input over the rows row[ineur] of all the source groups 
+//   to the target element t_elmt, see gather_synp()
+//--------------------------------------------------
+template <int NE, int NI>
+inline void Simulation::gather_elmt(const TInt& t_elmt, const TConnRow* row, const TInt& psp_front, const TInt& volt_rear,
+   const TInt& gate_delay, TGatherBuf& buf)
+{
+   //the buckets skipped for the target in this step share one tolerance
+   buf.gate_left = gGate_eps;
+
+#ifdef LCM_MODEL
+   //the groups of the compiled model one by one, LCM_MODEL_GROUPS(X) is X(0) X(1) ..., see lcmc.cpp
+#define GATHER_GROUP(S) gather_group<NE, NI, S>(t_elmt, gNeur[S], row[S], psp_front, volt_rear, gate_delay, buf);
+   LCM_MODEL_GROUPS(GATHER_GROUP)
+#undef GATHER_GROUP
+#else
+   for (vector<NeurGrp>::const_iterator sn_it = gNeur.begin(); sn_it != gNeur.end(); ++sn_it) {
+      gather_group<NE, NI, -1>(t_elmt, *sn_it, row[sn_it->index()], psp_front, volt_rear, gate_delay, buf);
+   } //end of loop for neuron groups
+#endif
+}
+
+//--------------------------------------------------
+// function void Simulation::gather_group<NE, NI, S>(const TInt& t_elmt, const NeurGrp& sn, 
+//      const TConnRow& row, const TInt& psp_front, const TInt& volt_rear, const TInt& gate_delay, TGatherBuf& buf)
+//   Add the input over the row of the source group sn to the target 
+//   element t_elmt, see gather_synp()
+//--------------------------------------------------
+template <int NE, int NI, int S>
+inline void Simulation::gather_group(const TInt& t_elmt, const NeurGrp& sn, const TConnRow& row, const TInt& psp_front,
+   const TInt& volt_rear, const TInt& gate_delay, TGatherBuf& buf)
+{
+   const TInt s_neur = (S >= 0) ? S : sn.index();
+
+   if (row.bgn == row.end && row.far_bgn == row.far_end) return;
+
+   if (gEns_num > 1) {
+      gather_ens(t_elmt, sn, (sn.type() == cEXCIT) ? gRcpt_excit : gRcpt_inhib, row, psp_front, volt_rear, buf);
+      return;
+   }
+
+   //the target receptors are determined by the type of the source
+   if (MODEL_NG(s_neur, type) == cEXCIT) {
+      gather_synp<NE, S>(t_elmt, sn, gRcpt_excit, row, psp_front, volt_rear, gate_delay, buf);
+   }
+   else {
+      gather_synp<NI, S>(t_elmt, sn, gRcpt_inhib, row, psp_front, volt_rear, gate_delay, buf);
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::gather_synp<NR, S>(const TInt& t_elmt, 
+//      const NeurGrp& sn, const vector<Receptor>& rcpt, const TConnRow& row,
+//      const TInt& psp_front, const TInt& volt_rear, const TInt& gate_delay, TGatherBuf& buf)
+//   Add the input from the source group sn over the connection row 
+//   to the target element t_elmt, for every synapse of sn, with the 
+//   rings at psp_front and volt_rear. NR is the number of receptors,
+//   or 0 for rcpt.size() (buf.scratch then holds 3 * gPSP_rcpt_num values).
+//   S is sn.index() in a compiled model, the synapses and the PSP tables
+//   are then the constants of the model, see MODEL_SYNP
+//
+//   With the activity gating, a bucket with a delay of at least 
+//   gate_delay is summed as gGate_mid * (sum of the ratios) if the
+//   PSP range of its slot, summed over the receptors, can only change 
+//   the input by what is left of gGate_eps for the target element in 
+//   this step (buf.gate_left), which is then reduced by that amount
+//--------------------------------------------------
+template <int NR, int S>
+inline void Simulation::gather_synp(const TInt& t_elmt, const NeurGrp& sn, const vector<Receptor>& rcpt, 
+   const TConnRow& row, const TInt& psp_front, const TInt& volt_rear, 
+   const TInt& gate_delay, TGatherBuf& buf)
+{
+   assert(NR == 0 || NR == static_cast<TInt>(rcpt.size()));
+
+   const TInt rcpt_num = (NR > 0) ? NR : rcpt.size();
+   const TInt s_neur = (S >= 0) ? S : sn.index();
+
+   //the input of every receptor, accumulated in one pass over the connections
+   TReal fix_buf[3 * (NR > 0 ? NR : 1)];
+   TReal *mag = (NR > 0) ? fix_buf : buf.scratch;
+   TReal *mag_sp = mag + rcpt_num;
+   TReal *sum = mag_sp + rcpt_num;
+
+   TInt t_neur, spk_delay, delay, slot, iconn, num, ircpt;
+   TReal tmp_NM, gate_NM, gate_dev;
+   bool gate_flg;
+
+   //loop over the synaptic connection, sn.synp_conn() gives all the synaptic connection the neuron group projecting to
+   const TInt synp_num = MODEL_SYNP_NUM(S, sn);
+   for (TInt isynp = 0; isynp < synp_num; ++isynp) {
+
+      t_neur = MODEL_SYNP(S, sn, isynp, postsynp); // target neuron group
+      spk_delay = MODEL_SYNP(S, sn, isynp, spk_delay);
+
+      tmp_NM = MODEL_SYNP(S, sn, isynp, weight) * (MODEL_NG(s_neur, V_rev) - gVolt[VOLT_IDX_AT(volt_rear, t_elmt, t_neur, 0)]);
+
+      for (ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+         mag[ircpt] = 0.;
+         mag_sp[ircpt] = 0.;
+      }
+
+      //a PSP deviation times ratio changes the input by gate_NM times as much
+      gate_NM = std::max(std::abs(tmp_NM), VOLT_EPS);
+
+      for (TInt ibkt = row.bgn; ibkt < row.end; ++ibkt) { //loop over the delays
+         //the PSP plane of all the source elements at the delay of the bucket
+         delay = spk_delay + row.bkt_delay[ibkt];
+         slot = PSP_SLOT_AT(psp_front, delay);
+         iconn = row.bkt_bgn[ibkt];
+         num = row.bkt_bgn[ibkt + 1] - iconn;
+
+         if (gGate_eps > 0.) {
+            buf.gate_num += num;
+
+            gate_flg = (delay >= gate_delay);
+            if (gate_flg) {
+               gate_dev = 0.;
+               for (ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+                  gate_dev += gGate_dev[GATE_IDX(slot, s_neur, ircpt)];
+               }
+               gate_dev *= row.bkt_wsum[ibkt] * gate_NM;
+               gate_flg = (gate_dev <= buf.gate_left);
+            }
+
+            //(nearly) the same PSP over the source elements
+            if (gate_flg) {
+               buf.gate_left -= gate_dev;
+               for (ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+                  mag[ircpt] += gGate_mid[GATE_IDX(slot, s_neur, ircpt)] * row.bkt_wsum[ibkt];
+                  mag_sp[ircpt] += gGate_mid[GATE_IDX(slot, s_neur, ircpt)] * row.bkt_wsum[ibkt];
+               }
+               buf.gate_skip += num;
+               continue;
+            }
+         }
+
+         //sum over the source elements for all the receptors
+         if (gPrecision != PRECISION_SINGLE) {
+            gGather.sum(gPSP.data() + PSP_IDX(slot, s_neur, 0, 0), gElmt_pad, rcpt_num,
+               row.src + iconn, row.pct + iconn, num, sum);
+            for (ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+               mag[ircpt] += sum[ircpt];
+            }
+         }
+         if (gPrecision != PRECISION_DOUBLE) {
+            gGather.sum(gPSP_sp.data() + PSP_IDX(slot, s_neur, 0, 0), gElmt_pad, rcpt_num,
+               row.src + iconn, row.pct_sp + iconn, num, sum);
+            for (ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+               mag_sp[ircpt] += sum[ircpt];
+            }
+         }
+      }
+
+      //the taps of the far field on the mean PSP of the blocks (double precision only)
+      for (TInt ibkt = row.far_bgn; ibkt < row.far_end; ++ibkt) {
+         delay = spk_delay + gFar_bkt_delay[ibkt];
+         slot = PSP_SLOT_AT(psp_front, delay);
+         iconn = gFar_bkt_bgn[ibkt];
+         num = gFar_bkt_bgn[ibkt + 1] - iconn;
+
+         gGather.sum(gFar_psp.data() + FAR_IDX(slot, s_neur, 0, 0), gFar_pad, rcpt_num,
+            gFar_src.data() + iconn, gFar_pct.data() + iconn, num, sum);
+         for (ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+            mag[ircpt] += sum[ircpt];
+         }
+      }
+
+      if (gPrecision == PRECISION_SINGLE) {
+         for (ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+            mag[ircpt] = mag_sp[ircpt];
+         }
+      }
+      else if (gPrecision == PRECISION_VALIDATE) {
+         for (ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+            buf.prec_dev = std::max(buf.prec_dev, std::abs((mag_sp[ircpt] - mag[ircpt]) * tmp_NM));
+            buf.prec_mag = std::max(buf.prec_mag, std::abs(mag[ircpt] * tmp_NM));
+         }
+      }
+
+      for (ircpt = 0; ircpt < rcpt_num; ++ircpt) { //loop over the target receptor
+         mag[ircpt] *= tmp_NM;
+
+         if (mag[ircpt] > VOLT_EPS) {
+            if (gKernel == KERNEL_TABLE) {
+               add2volt_table(t_elmt, t_neur, MODEL_PSP(S, rcpt, ircpt), MODEL_PSP_SIZE(S, rcpt, ircpt), 
+                  MODEL_SYNP(S, sn, isynp, psp_delay), mag[ircpt], volt_rear);
+            }
+            else {
+               add2volt(t_elmt, t_neur, rcpt[ircpt], MODEL_SYNP(S, sn, isynp, psp_delay), mag[ircpt], volt_rear);
+            }
+         }
+      } //end of loop for receptor
+   } //end of loop for synaptic connections
+}
+
+//--------------------------------------------------
+// function void Simulation::gather_ens(const TInt& t_elmt, 
+//      const NeurGrp& sn, const vector<Receptor>& rcpt, const TConnRow& row,
+//      const TInt& psp_front, const TInt& volt_rear, TGatherBuf& buf)
+//   gather_synp() for all the members of the ensemble: a connection 
+//   is read once and applied to the PSP of every member, which lie 
+//   side by side in gPSP, see Gather::sum_ens(). With the scalar 
+//   kernel, every member gets the input of a run on its own
+//--------------------------------------------------
+void Simulation::gather_ens(const TInt& t_elmt, const NeurGrp& sn, const vector<Receptor>& rcpt,
+   const TConnRow& row, const TInt& psp_front, const TInt& volt_rear, TGatherBuf& buf)
+{
+   const TInt rcpt_num = rcpt.size();
+   const TInt ens_num = gEns_num;
+   const TInt s_neur = sn.index();
+
+   //[ircpt][iens], the input of every receptor and member
+   TReal *mag = buf.ens;
+   TReal *sum = mag + rcpt_num * ens_num;
+   TReal *tmp_NM = sum + rcpt_num * ens_num; //[iens]
+
+   TInt t_neur, delay, slot, iconn, num, ircpt, iens;
+
+   for (vector<SynpConn>::const_iterator sy_it = sn.synp_conn().begin(); sy_it != sn.synp_conn().end(); ++sy_it) {
+
+      t_neur = sy_it->postsynp(); // target neuron group
+
+      for (iens = 0; iens < ens_num; ++iens) {
+         tmp_NM[iens] = sy_it->weight() * (sn.V_rev() - gVolt[VOLT_IDX_AT(volt_rear, t_elmt + gElmt_own * iens, t_neur, 0)]);
+      }
+
+      std::fill(mag, mag + rcpt_num * ens_num, 0.);
+
+      for (TInt ibkt = row.bgn; ibkt < row.end; ++ibkt) { //loop over the delays
+         delay = sy_it->spk_delay() + row.bkt_delay[ibkt];
+         slot = PSP_SLOT_AT(psp_front, delay);
+         iconn = row.bkt_bgn[ibkt];
+         num = row.bkt_bgn[ibkt + 1] - iconn;
+
+         gGather.sum_ens(gPSP.data() + PSP_IDX(slot, s_neur, 0, 0), gElmt_pad * ens_num, rcpt_num, ens_num,
+            row.src + iconn, row.pct + iconn, num, sum);
+         for (TInt k = 0; k < rcpt_num * ens_num; ++k) {
+            mag[k] += sum[k];
+         }
+      }
+
+      for (ircpt = 0; ircpt < rcpt_num; ++ircpt) { //loop over the target receptor
+         for (iens = 0; iens < ens_num; ++iens) {
+            TReal m = mag[iens + ens_num * ircpt] * tmp_NM[iens];
+
+            if (m > VOLT_EPS) {
+               add2volt(t_elmt + gElmt_own * iens, t_neur, rcpt[ircpt], sy_it->psp_delay(), m, volt_rear);
+            }
+         }
+      }
+   }
+}
+
+
+//--------------------------------------------------
+// function bool Simulation::init_chan(void)
+//   Set up the channels for ENGINE_FFT and ENGINE_SEPARABLE
+//
+//   Without jitter, the synapse ratio and the spike delay of a pathway
+//   depend only on the (wrapped) offset between the source and the target, 
+//   so the input of a target element t is a circular cross-correlation
+//     field(t) = sum_d sum_o kern_d(o) * psp(t + o, step - D - d)
+//   where kern_d(o) is the sum of the ratios over the pathways of offset o 
+//   with spike delay d, and D is the spike delay of the synapse (channel). 
+//   Return false if the configuration can not use the engines
+//--------------------------------------------------
+bool Simulation::init_chan(void)
+{
+   if (gSynp_jitter != 0.) {
+      cerr << "ERROR! SIMU.ENGINE = " << gEngine << " requires LCM.SYNP_JITTER = 0, "
+         << "the synapse ratios are not translation-invariant otherwise. " << _FILE_LINE_ << endl;
+      return false;
+   }
+
+   gChan_rcpt_num = std::max(gRcpt_excit.size(), gRcpt_inhib.size());
+
+   gChan_ptr.assign(gNG_num + 1, 0);
+   gChan_delay.clear();
+   gChan_neur.clear();
+   gChan_sy.assign(gNG_num, vector<TInt>());
+
+   for (vector<NeurGrp>::const_iterator sn_it = gNeur.begin(); sn_it != gNeur.end(); ++sn_it) {
+      TInt ineur = sn_it->index();
+      for (vector<SynpConn>::const_iterator sy_it = sn_it->synp_conn().begin(); sy_it != sn_it->synp_conn().end(); ++sy_it) {
+         TInt ichan;
+         for (ichan = gChan_ptr[ineur]; ichan < static_cast<TInt>(gChan_delay.size()); ++ichan) {
+            if (gChan_delay[ichan] == sy_it->spk_delay()) break;
+         }
+         if (ichan == static_cast<TInt>(gChan_delay.size())) {
+            gChan_delay.push_back(sy_it->spk_delay());
+            gChan_neur.push_back(ineur);
+         }
+         gChan_sy[ineur].push_back(ichan);
+      }
+      gChan_ptr[ineur + 1] = gChan_delay.size();
+   }
+
+   try {
+      gChan_field.assign(static_cast<size_t>(gChan_delay.size()) * gChan_rcpt_num * gElmt_num, 0.);
+   }
+   catch (bad_alloc& e) {
+      cerr << msg_allocation_error(e) << endl;
+      exit(-1);
+   }
+
+   return true;
+}
+
+//--------------------------------------------------
+// function bool Simulation::init_fft(void)
+//   Set up the data for ENGINE_FFT, see Simulation::init_chan()
+//
+//   kern_d of every delay d is transformed once here
+//--------------------------------------------------
+bool Simulation::init_fft(void)
+{
+   if (!init_chan())
+      return false;
+
+   gFFT.resize(gGrid_row);
+
+   vector<TComplex> work(gFFT.work_size());
+
+   //kernel taps binned by spike delay
+   gFFT_bin_ptr.assign(gNG_num + 1, 0);
+   gFFT_bin_delay.clear();
+   gFFT_kern.clear();
+
+   TInt max_bin_delay = 0;
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      map<TInt, vector<TComplex> > bins;
+      TInt idx;
+      //the offset (o_x, o_y) is also the displacement of the pathways from element 0
+      for (TInt o_x = 0; o_x < gGrid_row; ++o_x) {
+         for (TInt o_y = 0; o_y < gGrid_row; ++o_y) {
+            idx = (gGrid_row - o_y) % gGrid_row + gGrid_row * ((gGrid_row - o_x) % gGrid_row); //flipped
+            for (TInt ipath = 0; ipath < SPK_PATH_NUM; ++ipath) {
+               if (gSynp_kern[ineur][SPK_DELAY_IDX(o_x, o_y, ipath)] > SYNP_RATIO_EPS) {
+                  vector<TComplex> &plane = bins[gSpk_delay[ineur][SPK_DELAY_IDX(o_x, o_y, ipath)]];
+                  if (plane.empty()) plane.assign(gElmt_num, TComplex(0.));
+                  plane[idx] += gSynp_kern[ineur][SPK_DELAY_IDX(o_x, o_y, ipath)];
+               }
+            }
+         }
+      }
+
+      for (map<TInt, vector<TComplex> >::iterator it = bins.begin(); it != bins.end(); ++it) {
+         gFFT.forward(&(it->second)[0], &work[0]);
+         gFFT_bin_delay.push_back(it->first);
+         gFFT_kern.insert(gFFT_kern.end(), it->second.begin(), it->second.end());
+         max_bin_delay = std::max(max_bin_delay, it->first);
+      }
+      gFFT_bin_ptr[ineur + 1] = gFFT_bin_delay.size();
+   }
+
+   TInt max_chan_delay = 0;
+   for (vector<TInt>::const_iterator it = gChan_delay.begin(); it != gChan_delay.end(); ++it) {
+      max_chan_delay = std::max(max_chan_delay, *it);
+   }
+
+   gFFT_ring_size = nextpow2(max_bin_delay + max_chan_delay + 1);
+
+   //the scratch of every thread of the team, see advance_fft()
+   TInt nthrd = 1;
+#ifdef _OPENMP
+   nthrd = omp_get_max_threads();
+#endif
+
+   try {
+      gFFT_ring.assign(static_cast<size_t>(gNG_num) * gChan_rcpt_num * gFFT_ring_size * gElmt_num, TComplex(0.));
+      gFFT_work.assign(static_cast<size_t>(nthrd) * gFFT.work_size(), TComplex(0.));
+      gFFT_acc.assign(static_cast<size_t>(nthrd) * gElmt_num, TComplex(0.));
+   }
+   catch (bad_alloc& e) {
+      cerr << msg_allocation_error(e) << endl;
+      exit(-1);
+   }
+
+   return true;
+}
+
+//--------------------------------------------------
+// function bool Simulation::init_sep(void)
+//   Set up the data for ENGINE_SEPARABLE, see Simulation::init_chan()
+//
+//   A pathway can be written as a pair of signed offsets (u, v), 
+//   -gGrid_row <= u, v < gGrid_row, going from the target to the source.
+//   Its ratio NeurGrp::eqn_synp_ratio is h(|u|)*h(|v|), where h is 
+//   NeurGrp::eqn_synp_ratio_1d, but its delay depends on sqrt(u*u + v*v). 
+//   The taps with the dominant delay d0 over the rectangle U x U, where U 
+//   holds the offsets of all the taps above SYNP_RATIO_EPS, are applied by 
+//   a column pass and a row pass of h, and the kernel is corrected by
+//     +ratio at delay d and -h(|u|)*h(|v|) at delay d0, for a tap with d != d0
+//     -h(|u|)*h(|v|) at delay d0, for a pathway in U x U below SYNP_RATIO_EPS
+//--------------------------------------------------
+bool Simulation::init_sep(void)
+{
+   if (!init_chan())
+      return false;
+
+   gSep_delay.assign(gNG_num, 0);
+   gSep_ptr.assign(gNG_num + 1, 0);
+   gSep_off.clear();
+   gSep_wgt.clear();
+   gSep_corr_ptr.assign(gNG_num + 1, 0);
+   gSep_corr_off.clear();
+   gSep_corr_delay.clear();
+   gSep_corr_wgt.clear();
+
+   TInt n_uv = 2 * gGrid_row;
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      vector<bool> in_U(n_uv, false);  //in_U[u + gGrid_row]
+      map<TInt, TInt> tap_num;         //number of taps of a delay
+
+      TInt o_x, o_y, idx;
+      for (TInt u = -gGrid_row; u < gGrid_row; ++u) {
+         for (TInt v = -gGrid_row; v < gGrid_row; ++v) {
+            o_x = (u + gGrid_row) % gGrid_row;
+            o_y = (v + gGrid_row) % gGrid_row;
+            idx = SPK_DELAY_IDX(o_x, o_y, (u < 0) + 2 * (v < 0)); //see SPK_DELAY_IDX
+            if (gSynp_kern[ineur][idx] > SYNP_RATIO_EPS) {
+               in_U[u + gGrid_row] = true;
+               in_U[v + gGrid_row] = true;
+               ++tap_num[gSpk_delay[ineur][idx]];
+            }
+         }
+      }
+
+      if (tap_num.empty()) {
+         gSep_ptr[ineur + 1] = gSep_off.size();
+         gSep_corr_ptr[ineur + 1] = gSep_corr_off.size();
+         continue;
+      }
+
+      TInt d0 = tap_num.begin()->first;
+      for (map<TInt, TInt>::const_iterator it = tap_num.begin(); it != tap_num.end(); ++it) {
+         if (it->second > tap_num[d0]) d0 = it->first;
+      }
+      gSep_delay[ineur] = d0;
+
+      vector<TReal> h(n_uv, 0.);
+      for (TInt u = -gGrid_row; u < gGrid_row; ++u) {
+         if (!in_U[u + gGrid_row]) continue;
+         h[u + gGrid_row] = gNeur[ineur].eqn_synp_ratio_1d(abs(u) * gElmt_size, gElmt_size);
+         gSep_off.push_back(u);
+         gSep_wgt.push_back(h[u + gGrid_row]);
+      }
+      gSep_ptr[ineur + 1] = gSep_off.size();
+
+      //corrections, merged by (wrapped offset, delay)
+      map<pair<TInt, TInt>, TReal> corr;
+      TReal prod;
+      for (TInt u = -gGrid_row; u < gGrid_row; ++u) {
+         if (!in_U[u + gGrid_row]) continue;
+         for (TInt v = -gGrid_row; v < gGrid_row; ++v) {
+            if (!in_U[v + gGrid_row]) continue;
+            o_x = (u + gGrid_row) % gGrid_row;
+            o_y = (v + gGrid_row) % gGrid_row;
+            idx = SPK_DELAY_IDX(o_x, o_y, (u < 0) + 2 * (v < 0));
+            prod = h[u + gGrid_row] * h[v + gGrid_row];
+            if (gSynp_kern[ineur][idx] > SYNP_RATIO_EPS) {
+               if (gSpk_delay[ineur][idx] == d0) continue;
+               corr[make_pair(o_y + gGrid_row * o_x, gSpk_delay[ineur][idx])] += gSynp_kern[ineur][idx];
+            }
+            corr[make_pair(o_y + gGrid_row * o_x, d0)] -= prod;
+         }
+      }
+
+      for (map<pair<TInt, TInt>, TReal>::const_iterator it = corr.begin(); it != corr.end(); ++it) {
+         if (it->second == 0.) continue;
+         gSep_corr_off.push_back(it->first.first);
+         gSep_corr_delay.push_back(it->first.second);
+         gSep_corr_wgt.push_back(it->second);
+      }
+      gSep_corr_ptr[ineur + 1] = gSep_corr_off.size();
+   }
+
+   //the scratch of every thread of the team, see advance_sep()
+   TInt nthrd = 1;
+#ifdef _OPENMP
+   nthrd = omp_get_max_threads();
+#endif
+   gSep_tmp.assign(static_cast<size_t>(nthrd) * gElmt_num, 0.);
+
+   return true;
+}
+
+//--------------------------------------------------
+// function bool Simulation::init_push(void)
+//   Set up the data for ENGINE_PUSH and ENGINE_AUTO.
+//   With the input of a row of the connection list split as
+//      sum pct * PSP = rest * sum pct + sum pct * (PSP - rest),
+//   the first term is known, and only the sources with PSP != rest, 
+//   which are few if most of the sheet is at rest, add to the second.
+//   The sources of a step are scattered (pushed) into the fields of 
+//   all the future steps at once, so a target reads its input from
+//   one field per synapse instead of summing over the row
+//--------------------------------------------------
+bool Simulation::init_push(void)
+{
+   if (synp_store() != SYNP_STORE_TABLE) {
+      cerr << "ERROR! SIMU.ENGINE = " << gEngine << " requires LCM.SYNP_STORE = " << SYNP_STORE_TABLE << ". " << _FILE_LINE_ << endl;
+      return false;
+   }
+
+   if (gGate_eps > 0.) {
+      cerr << "ERROR! SIMU.ENGINE = " << gEngine << " requires SIMU.GATE_EPS = 0. " << _FILE_LINE_ << endl;
+      return false;
+   }
+
+   //transpose the connection list, the entries of a source 
+   //element are added in the order of the target element
+   gPush_ptr.assign(gNG_num * gElmt_num + 1, 0);
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) {
+         TInt row = CONN_ROW_IDX(ineur, t_elmt);
+         for (TInt iconn = gBkt_bgn[gConn_ptr[row]]; iconn < gBkt_bgn[gConn_ptr[row + 1]]; ++iconn) {
+            ++gPush_ptr[CONN_ROW_IDX(ineur, gConn_src[iconn]) + 1];
+         }
+      }
+   }
+   for (TInt irow = 0; irow < gNG_num * gElmt_num; ++irow) {
+      gPush_ptr[irow + 1] += gPush_ptr[irow];
+   }
+
+   gPush_tgt.resize(conn_num());
+   gPush_delay.resize(conn_num());
+   gPush_pct.resize(conn_num());
+   gPush_wtot.assign(gNG_num * gElmt_num, 0.);
+   gPush_dmax = 0;
+
+   vector<TInt> pos(gPush_ptr.begin(), gPush_ptr.end() - 1);
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) {
+         TInt row = CONN_ROW_IDX(ineur, t_elmt);
+         for (TInt ibkt = gConn_ptr[row]; ibkt < gConn_ptr[row + 1]; ++ibkt) {
+            for (TInt iconn = gBkt_bgn[ibkt]; iconn < gBkt_bgn[ibkt + 1]; ++iconn) {
+               TInt &ipush = pos[CONN_ROW_IDX(ineur, gConn_src[iconn])];
+               gPush_tgt[ipush] = t_elmt;
+               gPush_delay[ipush] = gBkt_delay[ibkt];
+               gPush_pct[ipush] = gConn_pct[iconn];
+               ++ipush;
+            }
+            gPush_wtot[row] += gBkt_wsum[ibkt];
+            gPush_dmax = std::max(gPush_dmax, gBkt_delay[ibkt]);
+         }
+      }
    }
 
-   tEvlt_step = 0;
-
-   simu_state = true;
+   //the PSP of the groups at rest, see step_psp()
+   //the gather visits the entries of a group once per synapse, so the push is 
+   //faster while the entries of the active sources are fewer than 
+   //(visits per entry) / PUSH_ENTRY_COST of all the entries
+   gPush_rest.assign(gNG_num * gPSP_rcpt_num, 0.);
+   gPush_smax = 0;
+   gPush_ratio = 0.;
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      gPush_ratio += static_cast<TReal>(gPush_ptr[gElmt_num * (ineur + 1)] - gPush_ptr[gElmt_num * ineur])
+         * gNeur[ineur].synp_conn().size();
+
+      TReal phi = gNeur[ineur].eqn_firing(gNeur[ineur].V_0());
+      const vector<Receptor> &rcpt = (gNeur[ineur].type() == cEXCIT) ? gRcpt_excit : gRcpt_inhib;
+      for (TInt ircpt = 0; ircpt < rcpt.size(); ++ircpt) {
+         gPush_rest[ircpt + gPSP_rcpt_num * ineur] = rcpt[ircpt].eqn_J(phi);
+      }
+      for (vector<SynpConn>::const_iterator sy_it = gNeur[ineur].synp_conn().begin(); sy_it != gNeur[ineur].synp_conn().end(); ++sy_it) {
+         gPush_smax = std::max(gPush_smax, sy_it->spk_delay());
+      }
+   }
 
-   cfg_str.clear();
+   gPush_ratio /= std::max(conn_num(), 1) * PUSH_ENTRY_COST;
 
-   cfg_str = Simulation::print();
+   //a field is read until gPush_smax steps after its step, and written from 
+   //gPush_dmax steps before. The longest spike delay and the longest pathway 
+   //may belong to different groups, so the fields do not fit the ring of a group 
+   //in gPSP (gPSP_ring), they have a ring of their own
+   gPush_slot_num = nextpow2(gPush_smax + gPush_dmax + 1);
+   gPush_field.assign(static_cast<size_t>(gPush_slot_num) * gNG_num * gElmt_num * gPSP_rcpt_num, 0.);
 
-   cout << "INFO: next check point is " << tCheck_pnt*gStep_size << " msec.\n";
+   gPush_act.clear();
+   gPush_delta.clear();
+   tPush_on = (gEngine == ENGINE_PUSH);
+   gPush_steps = 0;
 
    return true;
 }
 
 //--------------------------------------------------
-// function void Simulation::advance(void)
-// The function advances the stimulation for a time step 
+// function void Simulation::advance_fft(void)
+//   Calculate the fields of the channels, see Simulation::init_chan()
+//
+//   The spectrum of the newest PSP plane of each group/receptor is 
+//   saved in the ring, the field of a channel/receptor is obtained 
+//   by one inverse transform of the sum over the delay bins of 
+//   (kernel spectrum) x (PSP spectrum at the delay of the bin)
 //--------------------------------------------------
-void Simulation::advance(void)
+void Simulation::advance_fft(void)
 {
+   //the scratch of the thread, see init_fft()
+   TInt ithrd = 0;
+#ifdef _OPENMP
+   ithrd = omp_get_thread_num();
+#endif
+   TComplex *work = &gFFT_work[static_cast<size_t>(ithrd) * gFFT.work_size()];
+   TComplex *acc = &gFFT_acc[static_cast<size_t>(ithrd) * gElmt_num];
 
-   assert(simu_state); // Simulation::advance: the model is not ready!
+   TInt pair_num = gNG_num * gChan_rcpt_num;
 
-   ++tEvlt_step;
+#ifdef _OPENMP
+#pragma omp for
+#endif
+   for (TInt ipair = 0; ipair < pair_num; ++ipair) {
+      TInt ineur = ipair / gChan_rcpt_num;
+      TInt ircpt = ipair % gChan_rcpt_num;
 
-   tOut_flg = false;
+      if (ircpt >= static_cast<TInt>(gNeur[ineur].type() == cEXCIT ? gRcpt_excit.size() : gRcpt_inhib.size()))
+         continue;
+      if (gFFT_bin_ptr[ineur] == gFFT_bin_ptr[ineur + 1])
+         continue;
 
-   if (tEvlt_step > gTotal_step) return;
+      TComplex *plane = &gFFT_ring[FFT_RING_IDX(ineur, ircpt, tEvlt_step)];
+      const TReal *psp = gPSP.data() + PSP_IDX(tPSP_front, ineur, ircpt, 0);
 
-   for (vector<TTimeWin>::iterator it = output_time.begin(); it != output_time.end(); ++it) {
-      if (tEvlt_step > it->end_step) {
-         it = output_time.erase(it); //it will point to the next data
-         --it; //even if it==output_time.begin(), operation --it will not throw any exception
-         continue;
-      }
-      else if (tEvlt_step >= (it->bgn_step)) {
-         if ((tEvlt_step - (it->bgn_step)) % (it->inc_step) == 0) {
-            tOut_flg = true;
-         }
-         break;
+      for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
+         plane[ielmt] = psp[ielmt];
       }
+      gFFT.forward(plane, work);
    }
 
-   //calculate next check point
-   if (tEvlt_step == tCheck_pnt) {
-      TInt tmp;
-      tCheck_pnt = MAX_INT_NUM;
-      for (vector<ExSource>::iterator es_it = gExSrc.begin(); es_it != gExSrc.end(); ++es_it) {
-         tmp = es_it->check(tEvlt_step); //update the state of stimulators
-         if (tCheck_pnt > tmp) tCheck_pnt = tmp;
-      }
-      if (tCheck_pnt != MAX_INT_NUM) {
-         cout << "INFO: current simulation time=" << evlt_time() << " msec, " \
-            "next check point=" << tCheck_pnt*gStep_size << " msec." << endl;
-      }
-   }
+   TInt job_num = gChan_delay.size() * gChan_rcpt_num;
 
+#ifdef _OPENMP
+#pragma omp for
+#endif
+   for (TInt ijob = 0; ijob < job_num; ++ijob) {
+      TInt ichan = ijob / gChan_rcpt_num;
+      TInt ircpt = ijob % gChan_rcpt_num;
+      TInt ineur = gChan_neur[ichan];
 
-   for (vector<ExSource>::iterator es_it = gExSrc.begin(); es_it != gExSrc.end(); ++es_it) {
-      if (es_it->act_stim_num() == 0) continue;
+      if (ircpt >= static_cast<TInt>(gNeur[ineur].type() == cEXCIT ? gRcpt_excit.size() : gRcpt_inhib.size()))
+         continue;
+      if (gFFT_bin_ptr[ineur] == gFFT_bin_ptr[ineur + 1])
+         continue;
 
-#ifdef _OPENMP //OpenMP options
-#pragma omp parallel for
-      for (TInt idx = 0; idx < es_it->elmt_num(); ++idx) {
-#else
-      for (TInt idx = 0; idx < es_it->elmt_num(); ++idx) {
-#endif
-         TReal phi = es_it->generate(idx);
-         if (phi == 0) continue;
+      std::fill(acc, acc + gElmt_num, TComplex(0.));
 
-         TReal tmp_NM;
-         DynamicArray *t_volt;
-         for (vector<SynpConn>::const_iterator sy_it = es_it->synp_conn().begin(); sy_it != es_it->synp_conn().end(); ++sy_it) {
-            t_volt = gVolt[es_it->get_elmt(idx)] + (sy_it->postsynp());
-            tmp_NM = sy_it->weight() * (gV_rev_max - t_volt->rear());
-            for (vector<Receptor>::const_iterator rc_it = gRcpt_excit.begin(); rc_it != gRcpt_excit.end(); ++rc_it) {
-               t_volt->add2rear(rc_it->psp(), rc_it->psp_size(), sy_it->psp_delay(), tmp_NM * rc_it->eqn_J(phi));
-            }
+      const TComplex *kern, *plane;
+      for (TInt ibin = gFFT_bin_ptr[ineur]; ibin < gFFT_bin_ptr[ineur + 1]; ++ibin) {
+         kern = &gFFT_kern[static_cast<size_t>(ibin) * gElmt_num];
+         plane = &gFFT_ring[FFT_RING_IDX(ineur, ircpt, tEvlt_step - gChan_delay[ichan] - gFFT_bin_delay[ibin])];
+         for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
+            acc[ielmt] += kern[ielmt] * plane[ielmt];
          }
-      }//end of OpenMP parallel section
+      }
+
+      gFFT.backward(acc, work);
+
+      TReal *field = &gChan_field[CHAN_FIELD_IDX(ichan, ircpt, 0)];
+      for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
+         field[ielmt] = acc[ielmt].real() / gElmt_num;
+      }
    }
+}
 
-#ifdef _OPENMP //OpenMP options
-#pragma omp parallel for
-   for (TInt ielmt = 0; ielmt < gElmt_num; ++ielmt) {
-#else
-   for (TInt ielmt = 0; ielmt != gElmt_num; ++ielmt) {
+//--------------------------------------------------
+// function void Simulation::advance_sep(void)
+//   Calculate the fields of the channels, see Simulation::init_sep()
+//
+//   The PSP plane at delay D + d0 is filtered along the columns 
+//   and then along the rows, the corrections are added for 
+//   every target element directly
+//--------------------------------------------------
+void Simulation::advance_sep(void)
+{
+   //the scratch of the thread, see init_sep()
+   TInt ithrd = 0;
+#ifdef _OPENMP
+   ithrd = omp_get_thread_num();
 #endif
-      for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+   TReal *tmp = &gSep_tmp[static_cast<size_t>(ithrd) * gElmt_num];
 
-         TReal phi = gNeur[ineur].eqn_firing(gVolt[ielmt][ineur].rear());
+   TInt job_num = gChan_delay.size() * gChan_rcpt_num;
 
-         if (gNeur[ineur].type() == cEXCIT) {
+#ifdef _OPENMP
+#pragma omp for
+#endif
+   for (TInt ijob = 0; ijob < job_num; ++ijob) {
+      TInt ichan = ijob / gChan_rcpt_num;
+      TInt ircpt = ijob % gChan_rcpt_num;
+      TInt ineur = gChan_neur[ichan];
 
-            for (TInt ircpt = 0; ircpt < gRcpt_excit.size(); ++ircpt) {
-               gPSP[ielmt][ineur][ircpt].step_backward();
-               gPSP[ielmt][ineur][ircpt].set_front(gRcpt_excit[ircpt].eqn_J(phi));
-            }
+      if (ircpt >= static_cast<TInt>(gNeur[ineur].type() == cEXCIT ? gRcpt_excit.size() : gRcpt_inhib.size()))
+         continue;
+      if (gSep_ptr[ineur] == gSep_ptr[ineur + 1])
+         continue;
 
+      TInt delay = gChan_delay[ichan] + gSep_delay[ineur];
+      TInt sep_bgn = gSep_ptr[ineur];
+      TInt sep_end = gSep_ptr[ineur + 1];
+
+      //the PSP plane at the delay, contiguous in gPSP
+      const TReal *plane = gPSP.data() + PSP_IDX(PSP_SLOT(delay), ineur, ircpt, 0);
+
+      //column pass, along y (ielmt == y + gGrid_row*x)
+      TInt s_y;
+      for (TInt t_x = 0; t_x < gGrid_row; ++t_x) {
+         const TReal *row = &plane[gGrid_row * t_x];
+         for (TInt t_y = 0; t_y < gGrid_row; ++t_y) {
+            TReal sum = 0.;
+            for (TInt isep = sep_bgn; isep < sep_end; ++isep) {
+               s_y = t_y + gSep_off[isep];
+               if (s_y < 0) s_y += gGrid_row;
+               else if (s_y >= gGrid_row) s_y -= gGrid_row;
+               sum += gSep_wgt[isep] * row[s_y];
+            }
+            tmp[t_y + gGrid_row * t_x] = sum;
          }
-         else {
+      }
 
-            for (TInt ircpt = 0; ircpt < gRcpt_inhib.size(); ++ircpt) {
-               gPSP[ielmt][ineur][ircpt].step_backward();
-               gPSP[ielmt][ineur][ircpt].set_front(gRcpt_inhib[ircpt].eqn_J(phi));
+      //row pass, along x
+      TReal *field = &gChan_field[CHAN_FIELD_IDX(ichan, ircpt, 0)];
+      TInt s_x;
+      for (TInt t_x = 0; t_x < gGrid_row; ++t_x) {
+         for (TInt t_y = 0; t_y < gGrid_row; ++t_y) {
+            field[t_y + gGrid_row * t_x] = 0.;
+         }
+         for (TInt isep = sep_bgn; isep < sep_end; ++isep) {
+            s_x = t_x + gSep_off[isep];
+            if (s_x < 0) s_x += gGrid_row;
+            else if (s_x >= gGrid_row) s_x -= gGrid_row;
+            for (TInt t_y = 0; t_y < gGrid_row; ++t_y) {
+               field[t_y + gGrid_row * t_x] += gSep_wgt[isep] * tmp[t_y + gGrid_row * s_x];
             }
          }
       }
+
+      //corrections
+      TInt t_x, t_y, s_elmt;
+      for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) {
+         t_x = t_elmt / gGrid_row;
+         t_y = t_elmt % gGrid_row;
+         TReal sum = 0.;
+         for (TInt icorr = gSep_corr_ptr[ineur]; icorr < gSep_corr_ptr[ineur + 1]; ++icorr) {
+            s_x = (t_x + gSep_corr_off[icorr] / gGrid_row) % gGrid_row;
+            s_y = (t_y + gSep_corr_off[icorr] % gGrid_row) % gGrid_row;
+            s_elmt = s_y + gGrid_row * s_x;
+            sum += gSep_corr_wgt[icorr] * gPSP[PSP_IDX(PSP_SLOT(gChan_delay[ichan] + gSep_corr_delay[icorr]), ineur, ircpt, s_elmt)];
+         }
+         field[t_elmt] += sum;
+      }
    }
+}
 
+//--------------------------------------------------
+// function void Simulation::advance_field(void)
+//   Add the fields of the channels to the membrane potentials
+//   of the target elements, see Simulation::init_chan()
+//--------------------------------------------------
+void Simulation::advance_field(void)
+{
 #ifdef _OPENMP
-#pragma omp parallel for
-   for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) { //loop over the target elements
-#else
-   for (TInt t_elmt = 0; t_elmt != gElmt_num; ++t_elmt) { //loop over the target elements
+#pragma omp for
 #endif
+   for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) { //loop over the target elements
 
-      TInt d_x, d_y, s_neur, ircpt;
-      TInt delay;
+      TInt s_neur, t_neur, ircpt, isynp;
       TReal tmp_NM, mag;
 
-      TInt *spk_delay;
-      TReal *synp_pct;
-      DynamicArray *t_volt, *s_psp;
-
       vector<Receptor>::const_iterator rcpt_begin, rcpt_end;
 
       for (vector<NeurGrp>::const_iterator sn_it = gNeur.begin(); sn_it != gNeur.end(); ++sn_it) {
-         //if(sn_it->synp.empty()) continue;
 
          s_neur = sn_it->index();
 
@@ -519,107 +3121,314 @@ void Simulation::advance(void)
             rcpt_end = gRcpt_inhib.end();
          }
 
-         //loop over the synaptic connection, sn_it->synps() gives all the synaptic connection the neuron group projecting to
+         isynp = 0;
          for (vector<SynpConn>::const_iterator sy_it = sn_it->synp_conn().begin(); sy_it != sn_it->synp_conn().end(); ++sy_it) {
 
-            t_volt = &(gVolt[t_elmt][sy_it->postsynp()]); // pointer to target neuron group
+            t_neur = sy_it->postsynp(); // target neuron group
 
-            tmp_NM = sy_it->weight() * (sn_it->V_rev() - t_volt->rear());
+            tmp_NM = sy_it->weight() * (sn_it->V_rev() - gVolt[VOLT_IDX(t_elmt, t_neur, 0)]);
 
             ircpt = 0;
             for (vector<Receptor>::const_iterator rc_it = rcpt_begin; rc_it != rcpt_end; ++rc_it) { //loop over the target receptor
 
-               mag = 0.;
-               for (TInt s_elmt = 0; s_elmt < gElmt_num; ++s_elmt) { //loop over the source elements
-
-                  d_x = abs(gElmtX[t_elmt] - gElmtX[s_elmt]);
-                  d_y = abs(gElmtY[t_elmt] - gElmtY[s_elmt]);
-                  s_psp = &(gPSP[s_elmt][s_neur][ircpt]);
-
-                  //path 0, see LCM::init()
-                  spk_delay = gSpk_delay[s_neur] + SPK_DELAY_IDX(d_x, d_y, 0);
-                  synp_pct = gSynp_pct[s_neur] + SYNP_PCT_IDX(s_elmt, t_elmt, 0);
-                  if (*synp_pct > SYNP_RATIO_EPS) {
-                     delay = sy_it->spk_delay() + (*spk_delay);
-                     mag += tmp_NM * (*synp_pct) * s_psp->get_front(delay);
-                  }
-
-                  //path 1, see LCM::init()
-                  ++spk_delay;
-                  ++synp_pct;
-                  if (*synp_pct > SYNP_RATIO_EPS) {
-                     delay = sy_it->spk_delay() + (*spk_delay);
-                     mag += tmp_NM * (*synp_pct) * s_psp->get_front(delay);
-                  }
-
-                  //path 2, see LCM::init()
-                  ++spk_delay;
-                  ++synp_pct;
-                  if (*synp_pct > SYNP_RATIO_EPS) {
-                     delay = sy_it->spk_delay() + (*spk_delay);
-                     mag += tmp_NM * (*synp_pct) * s_psp->get_front(delay);
-                  }
-
-                  //path 3, see LCM::init()
-                  ++spk_delay;
-                  ++synp_pct;
-                  if (*synp_pct > SYNP_RATIO_EPS) {
-                     delay = sy_it->spk_delay() + (*spk_delay);
-                     mag += tmp_NM * (*synp_pct) * s_psp->get_front(delay);
-                  }
-
-               } //end of loop for source element
+               mag = tmp_NM * gChan_field[CHAN_FIELD_IDX(gChan_sy[s_neur][isynp], ircpt, t_elmt)];
 
                if (mag > VOLT_EPS) {
-                  t_volt->add2rear(rc_it->psp(), rc_it->psp_size(), sy_it->psp_delay(), mag);
+                  add2volt(t_elmt, t_neur, *rc_it, sy_it->psp_delay(), mag);
                }
 
                ++ircpt;
             } //end of loop for receptor
+
+            ++isynp;
          } //end of loop for synaptic connections
       } //end of loop for neuron groups
    } //end of loop for target element      
+}
 
-   //calculate the membrane potentials for neuron groups
+//--------------------------------------------------
+// function void Simulation::advance_push(void)
+//   Add the synaptic input of the current step with the fields of 
+//   the push, see Simulation::init_push(). With ENGINE_AUTO the gather
+//   (advance_sparse()) is used instead while the active sources have 
+//   too many entries (see gPush_ratio), and the fields are rebuilt from
+//   the PSP history when the push is resumed. The result is the same 
+//   as that of the gather, except for the rounding errors
+//--------------------------------------------------
+void Simulation::advance_push(void)
+{
 #ifdef _OPENMP
-#pragma omp parallel for
-   for (TInt s_elmt = 0; s_elmt < gElmt_num; ++s_elmt) {
-#else
-   for (TInt s_elmt = 0; s_elmt != gElmt_num; ++s_elmt) {
+#pragma omp single
 #endif
-      DynamicArray *t_volt;
-      TReal pre_volt, curr_volt;
-      for (TInt s_neur = 0; s_neur < gNG_num; ++s_neur) {
+   {
+      TInt act_conn = push_active(0);
+
+      tPush_replay = false;
+      if (gEngine == ENGINE_AUTO) {
+         TReal act_frac = static_cast<TReal>(act_conn) / std::max(conn_num(), 1);
+         if (!tPush_on && act_frac <= gPush_ratio) {
+            tPush_replay = true;
+            tPush_on = true;
+         }
+         else if (tPush_on && act_frac > gPush_ratio * PUSH_HYSTERESIS) {
+            tPush_on = false;
+         }
+      }
+   }
 
-         t_volt = &(gVolt[s_elmt][s_neur]);
+   if (tPush_replay) {
+      push_replay();
+#ifdef _OPENMP
+#pragma omp single
+#endif
+      push_active(0);
+   }
 
-         pre_volt = t_volt->rear(); //previous step value
+   if (!tPush_on) {
+      advance_sparse(0);
+      return;
+   }
 
-         t_volt->step_backward(); 
+#ifdef _OPENMP
+#pragma omp single
+#endif
+   {
+      ++gPush_steps;
 
-         //current step value is t_volt->rear();
+      //the field of the farthest step is reused, its step was read gPush_smax steps ago
+      TInt new_slot = PUSH_SLOT(tEvlt_step + gPush_dmax);
+      std::fill(gPush_field.begin() + PUSH_IDX(new_slot, 0, 0, 0), gPush_field.begin() + PUSH_IDX(new_slot + 1, 0, 0, 0), 0.);
+   }
 
-         //(V_(n-1) - V_0) * decay_factor + (V_n -V_0)
-         curr_volt = (pre_volt - gNeur[s_neur].V_0()) * gNeur[s_neur].mp_decay_step() + \
-            t_volt->rear();
+   push_scatter(0, 0);
 
-         if (curr_volt< gV_rev_min) {
-            curr_volt = gV_rev_min;
+   //the fields of a target are read by another thread below
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+   for (TInt t_elmt = 0; t_elmt < gElmt_num; ++t_elmt) { //loop over the target elements
+      TInt t_neur, s_neur, row, step, slot, rcpt_num;
+      TReal tmp_NM, wsum, mag;
+
+      for (vector<NeurGrp>::const_iterator sn_it = gNeur.begin(); sn_it != gNeur.end(); ++sn_it) {
+         s_neur = sn_it->index();
+         row = CONN_ROW_IDX(s_neur, t_elmt);
+         if (gConn_ptr[row] == gConn_ptr[row + 1]) continue;
+
+         const vector<Receptor> &rcpt = (sn_it->type() == cEXCIT) ? gRcpt_excit : gRcpt_inhib;
+         rcpt_num = rcpt.size();
+
+         for (vector<SynpConn>::const_iterator sy_it = sn_it->synp_conn().begin(); sy_it != sn_it->synp_conn().end(); ++sy_it) {
+            //the field of the step the spikes left the synapse
+            step = tEvlt_step - sy_it->spk_delay();
+            if (step < 1) continue;
+            slot = PUSH_SLOT(step);
+
+            //the ratios of the pathways of which the PSP was written (step 1 onwards)
+            wsum = gPush_wtot[row];
+            if (step <= gBkt_delay[gConn_ptr[row + 1] - 1]) {
+               wsum = 0.;
+               for (TInt ibkt = gConn_ptr[row]; ibkt < gConn_ptr[row + 1] && gBkt_delay[ibkt] < step; ++ibkt) {
+                  wsum += gBkt_wsum[ibkt];
+               }
+            }
+
+            t_neur = sy_it->postsynp();
+            tmp_NM = sy_it->weight() * (sn_it->V_rev() - gVolt[VOLT_IDX(t_elmt, t_neur, 0)]);
+
+            for (TInt ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+               mag = gPush_field[PUSH_IDX(slot, s_neur, t_elmt, ircpt)] + gPush_rest[ircpt + gPSP_rcpt_num * s_neur] * wsum;
+               mag *= tmp_NM;
+
+               if (mag > VOLT_EPS) {
+                  add2volt(t_elmt, t_neur, rcpt[ircpt], sy_it->psp_delay(), mag);
+               }
+            }
          }
-         else if (curr_volt > gV_rev_max) {
-            curr_volt = gV_rev_max;
+      }
+   }
+}
+
+//--------------------------------------------------
+// function TInt Simulation::push_active(const TInt& eps)
+//   List the sources of which the PSP eps steps before the current 
+//   step differs from that at rest, with the difference
+//--------------------------------------------------
+TInt Simulation::push_active(const TInt& eps)
+{
+   TInt act_conn = 0;
+
+   gPush_act.clear();
+   gPush_delta.clear();
+
+   //the PSP before the first step is not written
+   if (tEvlt_step - eps < 1) return 0;
+
+   TInt slot = PSP_SLOT(eps);
+   for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+      TInt rcpt_num = (gNeur[ineur].type() == cEXCIT) ? gRcpt_excit.size() : gRcpt_inhib.size();
+      const TReal *rest = gPush_rest.data() + gPSP_rcpt_num * ineur;
+
+      //the ring of the group no longer holds the step, of which the 
+      //input arrives before the oldest field its synapses read
+      if (eps >= gPSP_ring[ineur]) continue;
+
+      for (TInt s_elmt = 0; s_elmt < gElmt_num; ++s_elmt) {
+         if (gPush_ptr[CONN_ROW_IDX(ineur, s_elmt)] == gPush_ptr[CONN_ROW_IDX(ineur, s_elmt) + 1]) continue;
+
+         bool act_flg = false;
+         for (TInt ircpt = 0; ircpt < rcpt_num; ++ircpt) {
+            act_flg = act_flg || (gPSP[PSP_IDX(slot, ineur, ircpt, s_elmt)] != rest[ircpt]);
+         }
+         if (!act_flg) continue;
+
+         gPush_act.push_back(s_elmt + gElmt_num * ineur);
+         act_conn += gPush_ptr[CONN_ROW_IDX(ineur, s_elmt) + 1] - gPush_ptr[CONN_ROW_IDX(ineur, s_elmt)];
+         for (TInt ircpt = 0; ircpt < gPSP_rcpt_num; ++ircpt) {
+            gPush_delta.push_back(ircpt < rcpt_num ? gPSP[PSP_IDX(slot, ineur, ircpt, s_elmt)] - rest[ircpt] : 0.);
+         }
+      }
+   }
+
+   return act_conn;
+}
+
+//--------------------------------------------------
+// function void Simulation::push_scatter(const TInt& eps, const TInt& min_delay)
+//   Add the active sources listed by push_active(eps) to the fields of 
+//   the steps they reach. Every thread updates the fields of its own range 
+//   of targets, which is found in the (sorted) transposed rows by bisection,
+//   so the threads write without locks, and the result does not depend on 
+//   the number of threads
+//--------------------------------------------------
+void Simulation::push_scatter(const TInt& eps, const TInt& min_delay)
+{
+   if (gPush_act.empty()) return;
+
+   {
+      TInt ithrd = 0, nthrd = 1;
+#ifdef _OPENMP
+      ithrd = omp_get_thread_num();
+      nthrd = omp_get_num_threads();
+#endif
+      TInt t_bgn = static_cast<TInt>(static_cast<long long>(gElmt_num) * ithrd / nthrd);
+      TInt t_end = static_cast<TInt>(static_cast<long long>(gElmt_num) * (ithrd + 1) / nthrd);
+
+      const TInt *tgt = gPush_tgt.data();
+      for (TInt iact = 0; iact < gPush_act.size(); ++iact) {
+         TInt ineur = gPush_act[iact] / gElmt_num;
+         TInt row = CONN_ROW_IDX(ineur, gPush_act[iact] - gElmt_num * ineur);
+         const TReal *delta = gPush_delta.data() + gPSP_rcpt_num * iact;
+
+         TInt ipush = std::lower_bound(tgt + gPush_ptr[row], tgt + gPush_ptr[row + 1], t_bgn) - tgt;
+         for (; ipush < gPush_ptr[row + 1] && tgt[ipush] < t_end; ++ipush) {
+            if (gPush_delay[ipush] < min_delay) continue;
+
+            TInt slot = PUSH_SLOT(tEvlt_step - eps + gPush_delay[ipush]);
+            TReal *field = gPush_field.data() + PUSH_IDX(slot, ineur, tgt[ipush], 0);
+            for (TInt ircpt = 0; ircpt < gPSP_rcpt_num; ++ircpt) {
+               field[ircpt] += gPush_pct[ipush] * delta[ircpt];
+            }
          }
+      }
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::push_replay(void)
+//   Rebuild the fields from the PSP history, i.e., of the steps still 
+//   read (gPush_smax steps back) from the sources before the current step
+//--------------------------------------------------
+void Simulation::push_replay(void)
+{
+#ifdef _OPENMP
+#pragma omp single
+#endif
+   std::fill(gPush_field.begin(), gPush_field.end(), 0.);
+
+   for (TInt eps = gPush_smax + gPush_dmax; eps > 0; --eps) {
+#ifdef _OPENMP
+#pragma omp single
+#endif
+      push_active(eps);
+
+      //the step of the field is (current - eps + delay), which must not be older than gPush_smax steps
+      push_scatter(eps, eps - gPush_smax);
 
-         t_volt->set_rear(curr_volt);
+      //the list is replaced in the next step of the loop
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::add2volt(const TInt& ielmt, const TInt& ineur, 
+//      const Receptor& rc, const TInt& eps, const TReal& mag, const TInt& volt_rear)
+//   Add mag times the PSP of the receptor rc to the membrane potential 
+//   of the group ineur of the element ielmt from the step eps after the 
+//   step at volt_rear on. With KERNEL_TABLE the time course rc.psp() is
+//   added to the steps eps .. eps+rc.psp_size()-1 (as DynamicArray::add2rear()),
+//   with KERNEL_IIR the terms of the first step of the PSP are put into the
+//   delay lines of the two states, which step_volt() reads at that step,
+//   with KERNEL_VALIDATE both (the states with a ring of their own)
+//--------------------------------------------------
+void Simulation::add2volt(const TInt& ielmt, const TInt& ineur, const Receptor& rc, const TInt& eps, const TReal& mag,
+   const TInt& volt_rear)
+{
+   const TReal* RESTRICT psp = rc.psp();
+
+   if (gKernel != KERNEL_TABLE) {
+      TReal *ring = ((gKernel == KERNEL_IIR) ? gVolt : gVolt_iir).data() + VOLT_IDX_AT(0, ielmt, ineur, 0);
+
+      //the states start at the next step at the earliest, a PSP 
+      //at the current step is added to the ring
+      const TInt k0 = rc.iir_k0();
+      const TInt k_s = std::max(k0, 1 - eps);
+      assert(eps >= 0 && eps + k_s <= gVolt_slot_num);
+
+      for (TInt k = k0; k < k_s; ++k) {
+         ring[(volt_rear + eps + k) & (gVolt_slot_num - 1)] += psp[k] * mag;
       }
+
+      TReal *iir = gIIR.data() + IIR_IDX(ielmt, ineur, iir_slot(rc)) + 2;
+      const TInt slot = (volt_rear + eps + k_s) & (gVolt_slot_num - 1);
+      iir[slot] += rc.iir_p(k_s - k0) * mag;
+      iir[slot + gVolt_slot_num] += rc.iir_q(k_s - k0) * mag;
+      if (gKernel == KERNEL_IIR) return;
    }
 
-   //move the stimulator a step forward
-   for (vector<ExSource>::iterator es_it = gExSrc.begin(); es_it != gExSrc.end(); ++es_it) {
-      if (es_it->act_stim_num() == 0) continue;
-      es_it->advance(); //prepare the stimulators
+   add2volt_table(ielmt, ineur, psp, rc.psp_size(), eps, mag, volt_rear);
+}
+
+//--------------------------------------------------
+// function void Simulation::add2volt_table(const TInt& ielmt, const TInt& ineur, 
+//      const TReal* psp, const TInt& num, const TInt& eps, const TReal& mag, const TInt& volt_rear)
+//   add2volt() with KERNEL_TABLE, psp[0 .. num-1] is the time course of the PSP
+//--------------------------------------------------
+inline void Simulation::add2volt_table(const TInt& ielmt, const TInt& ineur, const TReal* RESTRICT psp, const TInt& num,
+   const TInt& eps, const TReal& mag, const TInt& volt_rear)
+{
+   TReal *ring = gVolt.data() + VOLT_IDX_AT(0, ielmt, ineur, 0);
+   assert(num > 0 && eps >= 0 && eps + num <= gVolt_slot_num);
+
+   TInt bgn = (volt_rear + eps) & (gVolt_slot_num - 1);
+
+   //the part before the end of the ring
+   TInt len = std::min(num, gVolt_slot_num - bgn);
+   TReal *it = ring + bgn;
+   for (TInt idx = 0; idx < len; ++idx) {
+      it[idx] += psp[idx] * mag;
    }
 
+   //the part wrapped to the beginning of the ring
+   for (TInt idx = len; idx < num; ++idx) {
+      ring[idx - len] += psp[idx] * mag;
+   }
 }
 
 
@@ -655,6 +3464,31 @@ string Simulation::print(void) const
    oss << "}" << endl;
    oss << "\tRAND_SEED = " << rand_seed() << "; //input value = " << gRand_seed << endl;
    oss << "\tTHREAD_NUM = " << gThread_num << ";" << endl;
+   oss << "\tPROC_NUM = " << gProc_num << ";" << endl;
+   oss << "\tTHREAD_PIN = " << gThread_pin << "; //" << (thread_pinned() ? "pinned" : "not pinned") << endl;
+   oss << "\tENGINE = " << gEngine << ";" << endl;
+   oss << "\tSIMD = " << gSimd << "; //" << Gather::name(gGather.level()) << endl;
+   oss << "\tPRECISION = " << gPrecision << ";" << endl;
+   oss << "\tPSP_KERNEL = " << gKernel << "; //" << (gKernel == KERNEL_IIR ? "recursive" : (gKernel == KERNEL_VALIDATE ? "validation" : "table")) << endl;
+   oss << "\tBLOCK_STEP = " << gBlock_cfg << "; //" << gBlock_step << " steps" << endl;
+   oss << "\tGATE_EPS = " << gGate_eps << ";" << endl;
+   oss << "\tFAR_RADIUS = " << gFar_radius << ";" << endl;
+   oss << "\tFAR_BLOCK = " << gFar_block << ";" << endl;
+   oss << "\tFAR_EPS = " << gFar_eps << ";";
+   if (gFar_radius > 0.) oss << " //" << gFar_dev << " found at init";
+   oss << endl;
+   oss << "\tSYMMETRY = " << gSymm_cfg << "; //" << (gSymm ? "one column" : "all elements") << endl;
+   oss << "\tELMT_ORDER = " << gElmt_cfg << "; //" << (gElmt_order == ORDER_HILBERT ? "Hilbert"
+      : (gElmt_order == ORDER_MORTON ? "Morton" : "row")) << endl;
+   oss << "\tENSEMBLE = " << gEns_num << ";" << endl;
+   if (gEns_num > 1) {
+      oss << "\tENSEMBLE_SCALE = {";
+      for (TInt iens = 0; iens < gEns_num; ++iens) {
+         if (iens > 0) oss << ", ";
+         oss << gEns_scale[iens];
+      }
+      oss << "};" << endl;
+   }
    oss << "};" << endl << endl;
 
    oss << LCM::print() << endl;
@@ -662,7 +3496,95 @@ string Simulation::print(void) const
    return oss.str();
 }
 
-void Simulation::get_data_header(vector<char> &buff)
+//--------------------------------------------------
+// function void Simulation::collect_volt(vector<TFloat>& volt, const TInt& iens)
+//   Collect the current membrane potentials of all the elements of the 
+//   member iens on the first process, volt[ineur + gNG_num*ielmt] (ielmt
+//   is the stored index). The other processes send those they own, volt
+//   is cleared
+//--------------------------------------------------
+void Simulation::collect_volt(vector<TFloat>& volt, const TInt& iens)
+{
+   vector<TFloat> own(static_cast<size_t>(gElmt_own) * gNG_num);
+   for (TInt ielmt = 0; ielmt < gElmt_own; ++ielmt) {
+      for (TInt ineur = 0; ineur < gNG_num; ++ineur) {
+         own[ineur + gNG_num * static_cast<size_t>(ielmt)] = static_cast<TFloat>(gVolt[VOLT_IDX(ielmt + gElmt_own * iens, ineur, 0)]);
+      }
+   }
+
+   volt.clear();
+   if (proc_rank() == 0) {
+      volt.resize(static_cast<size_t>(gElmt_num) * gNG_num);
+      std::copy(own.begin(), own.end(), volt.begin() + static_cast<size_t>(gElmt_bgn) * gNG_num);
+
+      //the column stands for all the elements
+      for (TInt ielmt = 1; ielmt < gElmt_num && gSymm; ++ielmt) {
+         std::copy(own.begin(), own.end(), volt.begin() + static_cast<size_t>(ielmt) * gNG_num);
+      }
+   }
+
+   if (gTrans == NULL) return;
+
+   vector<vector<char> > send(gProc_num), recv;
+   if (proc_rank() > 0) {
+      const char *pos = reinterpret_cast<const char*>(own.data());
+      send[0].assign(pos, pos + own.size() * sizeof(TFloat));
+   }
+
+   if (!gTrans->exchange(send, recv)) {
+      cerr << "ERROR! the membrane potentials can not be collected. " << _FILE_LINE_ << endl;
+      exit(-1);
+   }
+
+   if (proc_rank() > 0) return;
+
+   for (TInt iproc = 1; iproc < gProc_num; ++iproc) {
+      size_t num = static_cast<size_t>(proc_bgn(iproc + 1) - proc_bgn(iproc)) * gNG_num;
+      if (recv[iproc].size() != num * sizeof(TFloat)) {
+         cerr << "ERROR! process " << iproc << " sent " << recv[iproc].size() << " bytes of membrane potentials, "
+            << num * sizeof(TFloat) << " expected. " << _FILE_LINE_ << endl;
+         exit(-1);
+      }
+      memcpy(volt.data() + static_cast<size_t>(proc_bgn(iproc)) * gNG_num, recv[iproc].data(), recv[iproc].size());
+   }
+}
+
+//--------------------------------------------------
+// function void Simulation::get_volt(const TInt& ielmt, vector<TReal>& volt)
+//   The membrane potentials of the element ielmt (index on the grid) 
+//   on the first process, sent by the process owning it
+//--------------------------------------------------
+void Simulation::get_volt(const TInt& ielmt, vector<TReal>& volt)
+{
+   volt.assign(gNG_num, 0.);
+
+   TInt col = gSymm ? 0 : gGrid_col[ielmt];
+   bool own = (col >= 0 && col < gElmt_own);
+   for (TInt ineur = 0; ineur < gNG_num && own; ++ineur) {
+      volt[ineur] = gVolt[VOLT_IDX(col, ineur, 0)];
+   }
+
+   if (gTrans == NULL) return;
+
+   vector<vector<char> > send(gProc_num), recv;
+   if (own && proc_rank() > 0) {
+      const char *pos = reinterpret_cast<const char*>(volt.data());
+      send[0].assign(pos, pos + volt.size() * sizeof(TReal));
+   }
+
+   if (!gTrans->exchange(send, recv)) {
+      cerr << "ERROR! the membrane potentials can not be collected. " << _FILE_LINE_ << endl;
+      exit(-1);
+   }
+
+   for (TInt iproc = 1; iproc < gProc_num && proc_rank() == 0; ++iproc) {
+      if (recv[iproc].size() == volt.size() * sizeof(TReal)) {
+         memcpy(volt.data(), recv[iproc].data(), recv[iproc].size());
+      }
+   }
+}
+
+void Simulation::get_data_header(vector<char> &buff, const TInt& iens)
 {
    if (!is_ready()) {
       cerr << __FUNCTION__ << ": the model is not ready!" << _FILE_LINE_ << endl;
@@ -710,6 +3632,10 @@ void Simulation::get_data_header(vector<char> &buff)
    }
    oss << "} ; //the time period of the voltage data " << endl;
    oss << "SECTION_NUM = " << output_time.size() << "; //number of sections for the voltage data" << endl;
+   if (gEns_num > 1) {
+      oss << "ENSEMBLE_MEMBER = " << iens << "; //member of the ensemble (SIMU.ENSEMBLE), input scaled by "
+         << gEns_scale[iens] << endl;
+   }
 
    string str = oss.str();
 
@@ -731,7 +3657,7 @@ void Simulation::get_data_header(vector<char> &buff)
    buff.push_back(0);   //add a ending zero
 }
 
-void Simulation::get_data_block(vector<char> &buff)
+void Simulation::get_data_block(vector<char> &buff, const TInt& iens)
 {
    TInt block_size = (elmt_num() * ng_num() + 1) * sizeof(TFloat) + 1;
 
@@ -744,9 +3670,17 @@ void Simulation::get_data_block(vector<char> &buff)
 
    buff.insert(buff.end(), pos, pos + sizeof(TFloat));
 
+   vector<TFloat> volt;
+   collect_volt(volt, iens);
+   if (proc_rank() > 0) {
+      buff.clear();
+      return;
+   }
+
+   //the elements are written in the order of the grid
    for (TInt ielmt = 0; ielmt < elmt_num(); ++ielmt) {
       for (TInt ineur = 0; ineur < ng_num(); ++ineur) {
-         tmp = static_cast<TFloat>(gVolt[ielmt][ineur].rear());
+         tmp = volt[ineur + gNG_num * static_cast<size_t>(gElmt_idx[ielmt])];
          buff.insert(buff.end(), pos, pos + sizeof(TFloat));
       }
    }
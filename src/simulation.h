@@ -24,12 +24,73 @@
 
 #include "lcm.h"
 #include "array.h"
+#include "fft.h"
+#include "gather.h"
+#include "topology.h"
+#include "transport.h"
 #include "omp.h" 
 
 #ifndef VOLT_EPS
 #define VOLT_EPS 1e-6
 #endif
 
+//the largest number of members of an ensemble, see SIMU.ENSEMBLE
+#ifndef ENSEMBLE_MAX
+#define ENSEMBLE_MAX 16
+#endif
+
+//how the synaptic input from other elements is calculated
+#ifndef SIMU_ENGINE
+#define SIMU_ENGINE
+enum SimuEngine {
+    ENGINE_AUTO = -1,  //ENGINE_SPARSE or ENGINE_PUSH, chosen at every step by the work of the active sources
+    ENGINE_SPARSE = 0, //sum over the (sparse) connection list of every target element
+    ENGINE_FFT = 1,    //toroidal convolution in Fourier space, requires LCM.SYNP_JITTER = 0
+    ENGINE_SEPARABLE = 2, //row and column passes of the separable kernel, requires LCM.SYNP_JITTER = 0
+    ENGINE_PUSH = 3    //the active source elements scatter their PSP to the targets, requires LCM.SYNP_STORE = 0
+};
+#endif
+
+#ifndef PRECISION_ENUM
+#define PRECISION_ENUM
+enum Precision {
+    PRECISION_DOUBLE = 0,  //PSP history and synapse ratios in TReal
+    PRECISION_SINGLE = 1,  //PSP history and synapse ratios in TFloat (ENGINE_SPARSE only)
+    PRECISION_VALIDATE = 2 //both, the model runs in TReal and the deviation of TFloat is recorded
+};
+#endif
+
+//how a PSP is added to the membrane potential of the target, see Simulation::add2volt()
+#ifndef PSP_KERNEL_ENUM
+#define PSP_KERNEL_ENUM
+enum PspKernel {
+    KERNEL_TABLE = 0,  //the time course of the receptor (Receptor::psp()) is added to the future steps
+    KERNEL_IIR = 1,    //two states per receptor generate the PSP by a recursion, fed through a delay line
+    KERNEL_VALIDATE = 2 //both, the model runs with the table and the deviation of the recursion is recorded
+};
+#endif
+
+//the order the elements are stored in, see Simulation::init_order()
+#ifndef ELMT_ORDER_ENUM
+#define ELMT_ORDER_ENUM
+enum ElmtOrder {
+    ORDER_AUTO = -1,   //ORDER_HILBERT, or ORDER_ROW for ENGINE_FFT and ENGINE_SEPARABLE
+    ORDER_ROW = 0,     //the order of the grid, row by row
+    ORDER_HILBERT = 1, //along a Hilbert curve over the grid
+    ORDER_MORTON = 2   //along a Morton (Z-order) curve over the grid
+};
+#endif
+
+//whether a spatially homogeneous run is reduced to one column, see Simulation::init_symm()
+#ifndef SYMM_MODE_ENUM
+#define SYMM_MODE_ENUM
+enum SymmMode {
+    SYMM_AUTO = -1,    //SYMM_ON if the run is found to be homogeneous, else SYMM_OFF
+    SYMM_OFF = 0,      //every element is advanced
+    SYMM_ON = 1        //one column stands for all the elements, an error if the run is not homogeneous
+};
+#endif
+
 class TTimeWin {
 public:
     TTimeWin() { pnt_num = 0; };
@@ -47,20 +108,455 @@ class Simulation : public LCM
 {
 private:
 
-    DynamicArray      ***gPSP; //array for PSP
-    DynamicArray      **gVolt; //array for membrane potential
+    //the PSP and voltage histories of all the elements, each kept in one aligned arena.
+    //the rings of an arena are moved together by one index
+    //  gPSP:  [ineur][slot][ircpt][ielmt][iens], a delay slice over the source elements is contiguous
+    //  gVolt: [iens][ielmt][ineur][slot], a PSP is added to the future slots of a target element
+    //the PSP ring of a group only holds the steps its synapses read (gPSP_ring), a slot of 
+    //the index tPSP_front is taken modulo the length of the ring of the group
+    //the members of an ensemble (iens, see gEns_num) are side by side in gPSP, so the gather 
+    //reads all of them with one load per connection. In gVolt the member is the outermost 
+    //index, the element ielmt of the member iens is indexed as ielmt + gElmt_own*iens
+    AlignedArray<TReal>  gPSP;    //array for PSP
+    AlignedArray<TReal>  gVolt;   //array for membrane potential
+    AlignedArray<TFloat> gPSP_sp; //gPSP in single precision, see gPrecision
+
+    TInt              gPSP_rcpt_num;  // == max(gRcpt_excit.size(), gRcpt_inhib.size())
+    TInt              gElmt_pad;      // gElmt_num rounded up to whole aligned lines
+    TInt              gPSP_slot_num;  // must be a power of 2, the longest of gPSP_ring
+    std::vector<TInt> gPSP_ring;      //[ineur], length of the PSP ring of a group, a power of 2
+    std::vector<size_t> gPSP_off;     //[gNG_num + 1], first value of the PSP ring of a group
+    TInt              gVolt_slot_num; // must be a power of 2
+    TInt              tPSP_front;     // slot of the newest PSP
+    TInt              tVolt_rear;     // slot of the current membrane potential
+
+    //the recursive receptor kernels (KERNEL_IIR), see Simulation::add2volt(). For every 
+    //element, group and receptor (excitatory, then inhibitory) a block of 2*gVolt_slot_num + 2 
+    //values holds the two states of the PSP and their delay lines, which are indexed by the 
+    //slot of gVolt the input starts at:  [A, B, line of A[slot], line of B[slot]]
+    TInt                gKernel;        //SIMU.PSP_KERNEL
+    AlignedArray<TReal> gIIR;
+    TInt                gIIR_rcpt_num;  // == gRcpt_excit.size() + gRcpt_inhib.size()
+    //KERNEL_VALIDATE: the voltage ring the states add to (laid out as gVolt), and the largest
+    //deviation of its membrane potential from gVolt for every element (of all the members)
+    AlignedArray<TReal> gVolt_iir;
+    std::vector<TReal>  gIIR_dev;
+    std::vector<TReal>  gIIR_a;         //[irslot], the decay factors of the states
+    std::vector<TReal>  gIIR_b;
+
+#ifndef IIR_IDX
+#define IIR_IDX(ielmt, ineur, irslot) ((2*gVolt_slot_num + 2)*((irslot) + gIIR_rcpt_num*((ineur) + static_cast<size_t>(gNG_num)*(ielmt))))
+#endif
+
+    //the receptor slot of a receptor in gIIR
+    inline TInt iir_slot(const Receptor& rc) const {
+        return (rc.type() == cEXCIT) ? static_cast<TInt>(&rc - gRcpt_excit.data()) 
+            : static_cast<TInt>(gRcpt_excit.size() + (&rc - gRcpt_inhib.data()));
+    };
 
-    std::vector<TInt> gElmtX;
+#ifndef PSP_SLOT
+#define PSP_SLOT(eps) PSP_SLOT_AT(tPSP_front, eps)
+#define PSP_SLOT_AT(front, eps) (((front) + gPSP_slot_num - (eps)) & (gPSP_slot_num - 1))
+#endif
+
+#ifndef PSP_IDX
+#define PSP_IDX(islot, ineur, ircpt, ielmt) (gPSP_off[ineur] + gEns_num*((ielmt) + gElmt_pad*((ircpt) + gPSP_rcpt_num*static_cast<size_t>((islot) & (gPSP_ring[ineur] - 1)))))
+#endif
+
+#ifndef VOLT_IDX
+#define VOLT_IDX(ielmt, ineur, eps) VOLT_IDX_AT(tVolt_rear, ielmt, ineur, eps)
+#define VOLT_IDX_AT(rear, ielmt, ineur, eps) ((((rear) + (eps)) & (gVolt_slot_num - 1)) + gVolt_slot_num*((ineur) + static_cast<size_t>(gNG_num)*(ielmt)))
+#endif
+
+    //the elements are stored (in the histories, the connection list and the push) in the order
+    //of gElmt_order, so that the elements of a thread (a contiguous range of a static loop) 
+    //form a compact tile of the grid and share most of their source elements. The input of the 
+    //external sources and the output are mapped from/to the grid index
+    TInt              gElmt_cfg;   //SIMU.ELMT_ORDER
+    TInt              gElmt_order; //ORDER_ROW, ORDER_HILBERT or ORDER_MORTON
+    std::vector<TInt> gElmt_pos;   //[ielmt], grid index of a stored element
+    std::vector<TInt> gElmt_idx;   //[grid index], stored index of an element
+    std::vector<TInt> gElmtX;      //[ielmt], grid coordinates of a stored element
     std::vector<TInt> gElmtY;
 
-    //TInt              gVolt_arry_size;
-    //TInt              gPSP_arry_size;
+    //domain decomposition (SIMU.PROC_NUM), see init_proc() and init_domain(). A process 
+    //owns the stored elements gElmt_bgn .. gElmt_bgn + gElmt_own - 1, a tile of the curve 
+    //of gElmt_order. Its PSP planes hold gElmt_col columns: the elements it owns, then its 
+    //halo, the sources of its targets owned by the other processes, which are received 
+    //after every step or block (exchange_halo()). An owned element is indexed by its 
+    //column in the histories, and the loops over the targets run over gElmt_own
+    TInt              gProc_num;   //SIMU.PROC_NUM
+    Transport*        gTrans;      //NULL if gProc_num == 1
+    TInt              gElmt_bgn;
+    TInt              gElmt_own;
+    TInt              gElmt_col;
+    std::vector<TInt> gGrid_col;   //[grid index], column of an element, -1 if not held
+    std::vector<std::vector<TInt> > gHalo_send; //[proc], owned columns sent to a process
+    std::vector<std::vector<TInt> > gHalo_recv; //[proc], halo columns received from a process
+
+    //symmetry-reduced run (SIMU.SYMMETRY), see init_symm(). If every element on the torus
+    //gets the same input, the first stored element is the only column, its rows have one
+    //entry per delay bucket (the sum of the ratios), and the other elements read its values
+    TInt              gSymm_cfg;   //SIMU.SYMMETRY
+    bool              gSymm;       //whether the run is reduced to one column
+    TInt              gSymm_conn;  //entries of the rows of the column before the reduction
+
+    //ensemble mode (SIMU.ENSEMBLE): gEns_num members run on the same connections, with 
+    //their own histories and stimulators. The stimulators of a member are copies of gExSrc,
+    //which draw their seeds (when they are started) from gEns_rand, and its input from the 
+    //external sources is scaled by gEns_scale. The first member is the same as a run without
+    //the ensemble
+    TInt              gEns_num;
+    std::vector<TReal> gEns_scale; //[iens], SIMU.ENSEMBLE_SCALE
+    std::vector<std::vector<ExSource> > gEns_src; //[iens - 1][isrc], the external sources of the other members
+    RandStream        gEns_rand;  //the stream the stimulators of the other members draw their seeds from
+
+    //the external source isrc of the member iens
+    inline ExSource& ens_src(const TInt& iens, const TInt& isrc) {
+        return (iens == 0) ? gExSrc[isrc] : gEns_src[iens - 1][isrc];
+    };
 
     TInt              tCheck_pnt;
     TInt              tEvlt_step;
 
     TInt              gRand_seed;
     TInt              gThread_num;
+    TInt              gThread_pin; //whether the threads are pinned, see init_thread()
+    Topology          gTopo;
+    std::vector<TInt> gThread_cpu; //processor of a thread if pinned
+    TInt              gEngine; //ENGINE_AUTO, ENGINE_SPARSE, ENGINE_FFT, ENGINE_SEPARABLE or ENGINE_PUSH, see SimuEngine
+    TInt              gSimd;   //SIMD level of the gather kernel (ENGINE_SPARSE), see gather.h
+    Gather            gGather;
+
+    //precision of the gather (ENGINE_SPARSE), gPSP and/or gPSP_sp are kept accordingly
+    TInt                gPrecision;
+    std::vector<TFloat, TouchAllocator<TFloat> > gConn_pct_sp; //gConn_pct in single precision (SYNP_STORE_TABLE)
+    TReal               gPrec_dev;    //largest deviation of the single precision input (PRECISION_VALIDATE)
+    TReal               gPrec_mag;    //largest magnitude of the double precision input (PRECISION_VALIDATE)
+
+    //temporal blocking (ENGINE_SPARSE), see advance(const TInt&)
+    TInt                gBlock_cfg;   //SIMU.BLOCK_STEP, 0 for LCM::block_step_max()
+    TInt                gBlock_step;  //the largest number of steps advanced in a block
+    std::vector<TReal>  gBlock_phi;   //[istep][isrc][iens][ielmt], input of the external sources in a block
+
+    //the thread team of advance(const TInt&), which lives over all the steps of a call
+    TInt                tTeam_stop;   //the step the call ends at
+    TInt                tTeam_step;   //steps of the current block, 0 if the call has finished
+    bool                tTeam_block;  //whether the block is run by advance_sparse(nstep)
+
+#ifndef BLOCK_PHI_IDX
+#define BLOCK_PHI_IDX(istep, isrc, ielmt) ((ielmt) + gElmt_own*gEns_num*((isrc) + gExSrc.size()*static_cast<size_t>(istep)))
+#endif
+
+    //activity gating (ENGINE_SPARSE), see Simulation::gate_psp(). For every slot of the
+    //PSP ring the PSP of a group/receptor over the elements lies in gGate_mid +- gGate_dev,
+    //delay buckets are summed as gGate_mid * (sum of the ratios) while their errors 
+    //to a target element in a step add up to at most gGate_eps
+    TReal               gGate_eps;    //SIMU.GATE_EPS (mV), 0 turns the gating off
+    std::vector<TReal>  gGate_mid;    //[islot][ineur][ircpt]
+    std::vector<TReal>  gGate_dev;    //[islot][ineur][ircpt]
+    std::vector<TReal, TouchAllocator<TReal> > gBkt_wsum; //sum of the ratios of a bucket of the connection list (SYNP_STORE_TABLE)
+    TReal               gGate_skip;   //connection entries replaced by gGate_mid
+    TReal               gGate_num;    //connection entries over all the synapses and steps
+
+#ifndef GATE_IDX
+#define GATE_IDX(islot, ineur, ircpt) ((ircpt) + gPSP_rcpt_num*((ineur) + gNG_num*(islot)))
+#endif
+
+    //far-field approximation (ENGINE_SPARSE), see Simulation::init_far(). The grid is cut
+    //into blocks of gFar_block x gFar_block elements. The entries of a row beyond gFar_radius
+    //are replaced by taps on the mean PSP of a block (gFar_psp), one tap for the entries
+    //of a block within the delay span of a block, at their mean delay. The taps are grouped
+    //by delay into buckets like the connection list, gFar_near[row] ends the exact buckets
+    TReal               gFar_radius;  //SIMU.FAR_RADIUS (mm), 0 turns the far field off
+    TInt                gFar_block;   //SIMU.FAR_BLOCK (elements)
+    TReal               gFar_eps;     //SIMU.FAR_EPS, the largest deviation allowed at init (relative)
+    TInt                gFar_side;    //blocks along a side of the grid
+    TInt                gFar_blk_num; // == gFar_side * gFar_side
+    TInt                gFar_pad;     // gFar_blk_num rounded up to whole aligned lines
+    std::vector<TInt>   gFar_blk;     //[column], block of a column
+    std::vector<TReal>  gFar_inv;     //[iblk], 1 / number of the elements of a block
+    AlignedArray<TReal> gFar_psp;     //[islot][ineur][ircpt][iblk], mean PSP of the blocks
+    std::vector<TInt>   gFar_near;    //[row], end of the exact buckets of a row
+    std::vector<TInt>   gFar_ptr;     //[row + 1], buckets of the taps of a row
+    std::vector<TInt>   gFar_bkt_bgn; //[bucket number + 1]
+    std::vector<TInt>   gFar_bkt_delay;
+    std::vector<TInt>   gFar_src;     //block of a tap
+    std::vector<TReal>  gFar_pct;     //sum of the ratios of the entries of a tap
+    TReal               gFar_conn;    //entries replaced by the taps
+    TReal               gFar_tap;     //taps
+    TReal               gFar_dev;     //largest deviation found by the check at init
+
+#ifndef FAR_IDX
+#define FAR_IDX(islot, ineur, ircpt, iblk) ((iblk) + gFar_pad*((ircpt) + gPSP_rcpt_num*((ineur) + static_cast<size_t>(gNG_num)*(islot))))
+#endif
+
+#ifndef FAR_BLOCK_DEFAULT
+#define FAR_BLOCK_DEFAULT 4
+#define FAR_EPS_DEFAULT 0.01
+#endif
+
+    //channels for ENGINE_FFT and ENGINE_SEPARABLE, see Simulation::init_chan()
+    //a channel is a distinct synaptic spike delay of a group, the field of a channel/receptor
+    //is the input from all the source elements, without the factor of the synapse 
+    TInt                  gChan_rcpt_num; // == max(gRcpt_excit.size(), gRcpt_inhib.size())
+    std::vector<TInt>     gChan_ptr;      //[gNG_num + 1]
+    std::vector<TInt>     gChan_delay;    //synaptic spike delay of a channel
+    std::vector<TInt>     gChan_neur;     //neuron group of a channel
+    std::vector<std::vector<TInt> > gChan_sy; //[ineur][isynp], channel of a synapse
+    std::vector<TReal>    gChan_field;    //[chan][ircpt][gElmt_num]
+
+#ifndef CHAN_FIELD_IDX
+#define CHAN_FIELD_IDX(ichan, ircpt, ielmt) ((ielmt) + gElmt_num*((ircpt) + gChan_rcpt_num*(ichan)))
+#endif
+
+    //data for ENGINE_PUSH (and ENGINE_AUTO), see Simulation::init_push()
+    //the connection list is transposed, the entries from a source element are sorted by target.
+    //gPush_field[slot][ineur][ielmt][ircpt] is the input from the group ineur arriving at the target 
+    //ielmt at the step of the slot (before the spike delay of the synapse), less the input if all the
+    //sources were at rest, so only the sources with a PSP other than that at rest are scattered.
+    //The fields have a ring of their own, the slot of the step istep is PUSH_SLOT(istep)
+    std::vector<TInt>     gPush_ptr;    //[gNG_num * gElmt_num + 1], CONN_ROW_IDX(ineur, s_elmt)
+    std::vector<TInt>     gPush_tgt;    //target element of an entry
+    std::vector<TInt>     gPush_delay;  //spike delay of an entry
+    std::vector<TReal>    gPush_pct;    //synapse ratio of an entry
+    std::vector<TReal>    gPush_rest;   //[ineur][ircpt], PSP of a group at rest
+    std::vector<TReal>    gPush_wtot;   //[ineur][ielmt], sum of the ratios of a row of the connection list
+    std::vector<TReal>    gPush_field;  //[slot][ineur][ielmt][ircpt]
+    TInt                  gPush_slot_num; //must be a power of 2, > gPush_smax + gPush_dmax
+    std::vector<TInt>     gPush_act;    //active sources of a step, == s_elmt + gElmt_num*ineur
+    std::vector<TReal>    gPush_delta;  //[iact][ircpt], PSP less that at rest of an active source
+    TInt                  gPush_dmax;   //largest delay of the connection list
+    TInt                  gPush_smax;   //largest spike delay of the synapses
+    TReal                 gPush_ratio;  //ENGINE_AUTO pushes below this share of entries from active sources
+    bool                  tPush_on;     //whether gPush_field is up to date (ENGINE_AUTO)
+    TInt                  gPush_steps;  //steps run with the push
+    bool                  tPush_replay; //whether gPush_field is rebuilt in the current step
+
+#ifndef PUSH_IDX
+#define PUSH_IDX(islot, ineur, ielmt, ircpt) ((ircpt) + gPSP_rcpt_num*((ielmt) + gElmt_num*((ineur) + static_cast<size_t>(gNG_num)*(islot))))
+#endif
+#ifndef PUSH_SLOT
+#define PUSH_SLOT(istep) ((istep) & (gPush_slot_num - 1))
+#endif
+
+#ifndef PUSH_ENTRY_COST
+#define PUSH_ENTRY_COST 10.  //time to scatter an entry over that of a gather visit (measured with AVX2)
+#define PUSH_HYSTERESIS 1.25 //ENGINE_AUTO goes back to the gather above gPush_ratio * PUSH_HYSTERESIS
+#endif
+
+    //data for ENGINE_FFT, see Simulation::init_fft()
+    //the kernel taps of a neuron group are binned by spike delay, and the spectrum of 
+    //the PSP plane (over the grid) of a group/receptor is saved for every step in a ring
+    FFT2D                 gFFT;
+    TInt                  gFFT_ring_size; // must be a power of 2
+    std::vector<TInt>     gFFT_bin_ptr;   //[gNG_num + 1]
+    std::vector<TInt>     gFFT_bin_delay; //spike delay over the elements of a bin
+    std::vector<TComplex> gFFT_kern;      //[bin][gElmt_num], spectrum of the flipped kernel
+    std::vector<TComplex> gFFT_ring;      //[ineur][ircpt][slot][gElmt_num]
+    std::vector<TComplex> gFFT_work;      //[thread][gFFT.work_size()], scratch of the transforms
+    std::vector<TComplex> gFFT_acc;       //[thread][gElmt_num], sum over the bins of a channel
+
+#ifndef FFT_RING_IDX
+#define FFT_RING_IDX(ineur, ircpt, istep) (gElmt_num*(((istep) & (gFFT_ring_size - 1)) + gFFT_ring_size*((ircpt) + gChan_rcpt_num*(ineur))))
+#endif
+
+    //data for ENGINE_SEPARABLE, see Simulation::init_sep()
+    //the taps of the dominant delay class gSep_delay are applied as a product of
+    //two 1D kernels, the offsets of which are signed (-gGrid_row <= off < gGrid_row).
+    //the other taps, and the taps of the product that are dropped by SYNP_RATIO_EPS, 
+    //are listed as corrections, with wrapped offsets (0 <= off < gGrid_row)
+    std::vector<TInt>     gSep_delay;     //[gNG_num], delay of the dominant class
+    std::vector<TInt>     gSep_ptr;       //[gNG_num + 1], 1D kernel (same for rows and columns)
+    std::vector<TInt>     gSep_off;
+    std::vector<TReal>    gSep_wgt;
+    std::vector<TInt>     gSep_corr_ptr;  //[gNG_num + 1]
+    std::vector<TInt>     gSep_corr_off;  //== off_y + gGrid_row*off_x
+    std::vector<TInt>     gSep_corr_delay;
+    std::vector<TReal>    gSep_corr_wgt;
+    std::vector<TReal>    gSep_tmp;       //[thread][gElmt_num], the plane after the column pass
+
+    //set up the thread team from the topology and gThread_num/gThread_pin
+    void init_thread(void);
+
+    //set up the order of the elements from gElmt_cfg and the engine, see gElmt_order
+    bool init_order(void);
+
+    //start the processes of a distributed run (gProc_num > 1), before any parallel region
+    void init_proc(void);
+
+    //set up the elements owned by the process and its halo, see gElmt_own
+    bool init_domain(void);
+
+    //reduce a spatially homogeneous run to one column, see gSymm_cfg. Return false
+    //if SIMU.SYMMETRY = SYMM_ON and the run is not homogeneous
+    bool init_symm(void);
+
+    //return an empty string if every element gets the same input, else the reason
+    std::string symm_broken(void) const;
+
+    //the first stored element owned by the process iproc
+    inline TInt proc_bgn(const TInt& iproc) const {
+        return static_cast<TInt>(static_cast<long long>(gElmt_num) * iproc / gProc_num);
+    };
+
+    //send the PSP of the nstep slots up to psp_front to the halos of the other processes,
+    //and receive the own halo (one thread)
+    void exchange_halo(const TInt& psp_front, const TInt& nstep);
+
+    //collect the current membrane potentials of all the elements ([stored element][ineur])
+    //of the member iens on the first process, called by every process
+    void collect_volt(std::vector<TFloat>& volt, const TInt& iens);
+
+    //copy the connection list to the pages of the threads reading the rows (first touch),
+    //in the order of the elements
+    void place_conn(void);
+
+    //set up the data for the engines
+    bool init_chan(void);
+    bool init_fft(void);
+    bool init_sep(void);
+    bool init_push(void);
+
+    //size the buffers of the threads of the team, see TStepBuf
+    void init_step_buf(void);
+
+    //start a new step: update the step number, the output flag and the stimulators
+    //return false if the simulation has finished
+    bool begin_step(void);
+
+    //The parts of advance(const TInt&) below are called by every thread of the team,
+    //the work is shared with orphaned worksharing loops and the serial parts are run 
+    //by one thread (omp single). They also run without a team (one thread)
+    //
+    //plan the next block of the team (master thread), see tTeam_step
+    void begin_block(void);
+    //run the step started by begin_step() 
+    void step_team(void);
+    //finish a block run by advance_sparse(nstep) (one thread)
+    void end_block(void);
+
+    //ENGINE_SPARSE: add the synaptic input from the other elements for the current step
+    //if nstep == 0, or run nstep whole steps of a block, see advance(const TInt&)
+    void advance_sparse(const TInt& nstep);
+
+    //a row of the connection list (or regenerated from the stencils), see advance_sparse()
+    struct TConnRow {
+        TInt          bgn, end;  //buckets of the row
+        const TInt*   src;
+        const TReal*  pct;
+        const TFloat* pct_sp;    //pct in single precision (PRECISION_SINGLE/VALIDATE)
+        const TInt*   bkt_bgn;
+        const TInt*   bkt_delay;
+        const TReal*  bkt_wsum;  //sum of the ratios of a bucket (activity gating only)
+        TInt          far_bgn, far_end; //buckets of the taps on gFar_psp (far field only)
+    };
+
+    //the state of a thread in advance_sparse()
+    struct TGatherBuf {
+        TReal*  scratch;    //3 * gPSP_rcpt_num values for the generic version
+        TReal*  ens;        //(2 * gPSP_rcpt_num + 1) * gEns_num values for the ensemble
+        TReal   prec_dev;   //PRECISION_VALIDATE only
+        TReal   prec_mag;
+        TReal   gate_skip;  //activity gating only
+        TReal   gate_num;
+        TReal   gate_left;  //the part of gGate_eps the target element has not used yet
+    };
+
+    //the buffers of a thread in step_team() and advance_sparse(), sized once by init_step_buf()
+    struct TStepBuf {
+        std::vector<TConnRow> row;          //[gNG_num], the rows from the source groups to a target
+        std::vector<TInt>     row_src;      //[gNG_num][row_max], rows regenerated from the stencils
+        std::vector<TInt>     row_bkt_bgn;  //(SYNP_STORE_KERNEL only)
+        std::vector<TInt>     row_bkt_delay;
+        std::vector<TReal>    row_pct;
+        std::vector<TReal>    row_bkt_wsum;
+        std::vector<TFloat>   row_pct_sp;
+        std::vector<TReal>    scratch;      //see TGatherBuf
+        std::vector<TReal>    ens;
+        std::vector<TReal>    rcpt_J;       //eqn_J of the input of an external source
+    };
+    std::vector<TStepBuf> gStep_buf;        //[thread]
+
+    //advance_sparse() specialised on the numbers of the excitatory and the inhibitory receptors
+    template <int NE, int NI>
+    void advance_sparse_shape(const TInt& nstep);
+
+    //add the input over the rows of all the source groups to a target element
+    template <int NE, int NI>
+    void gather_elmt(const TInt& t_elmt, const TConnRow* row, const TInt& psp_front, const TInt& volt_rear,
+        const TInt& gate_delay, TGatherBuf& buf);
+
+    //add the input over the row of a source group to a target element, S is the
+    //group of a compiled model (see MODEL_SYNP in simulation.cpp), or -1
+    template <int NE, int NI, int S>
+    void gather_group(const TInt& t_elmt, const NeurGrp& sn, const TConnRow& row, const TInt& psp_front, 
+        const TInt& volt_rear, const TInt& gate_delay, TGatherBuf& buf);
+
+    //add the input over a connection row through every synapse of a source group
+    template <int NR, int S>
+    void gather_synp(const TInt& t_elmt, const NeurGrp& sn, const std::vector<Receptor>& rcpt,
+        const TConnRow& row, const TInt& psp_front, const TInt& volt_rear, 
+        const TInt& gate_delay, TGatherBuf& buf);
+
+    //gather_synp() for all the members of the ensemble (gEns_num > 1)
+    void gather_ens(const TInt& t_elmt, const NeurGrp& sn, const std::vector<Receptor>& rcpt,
+        const TConnRow& row, const TInt& psp_front, const TInt& volt_rear, TGatherBuf& buf);
+
+    //record the range of the PSP over the elements in a slot, see gGate_eps
+    void gate_psp(const TInt& islot);
+
+    //replace the entries of the rows beyond gFar_radius by the taps on the blocks,
+    //return false if the check of the deviation fails, see gFar_eps
+    bool init_far(void);
+
+    //record the mean PSP of the blocks in a slot, see gFar_psp
+    void far_psp(const TInt& islot);
+
+    void advance_fft(void);
+    void advance_sep(void);
+
+    //ENGINE_PUSH and ENGINE_AUTO: add the synaptic input from the other elements for the current step
+    void advance_push(void);
+
+    //list the active sources of the step eps steps before the current one,
+    //return the number of their entries in the transposed connection list
+    TInt push_active(const TInt& eps);
+
+    //scatter the active sources listed by push_active(eps) to the fields of the 
+    //pathways with a delay of at least min_delay
+    void push_scatter(const TInt& eps, const TInt& min_delay);
+
+    //rebuild gPush_field from the PSP history
+    void push_replay(void);
+
+    //add the fields of the channels to the membrane potentials (ENGINE_FFT and ENGINE_SEPARABLE)
+    void advance_field(void);
+
+    //write the PSP of a group/receptor of the member iens into the slot psp_front of gPSP and/or gPSP_sp
+    inline void set_psp(const TInt& psp_front, const TInt& ielmt, const TInt& ineur, const TInt& ircpt, const TReal& val,
+        const TInt& iens = 0) {
+        if (!gPSP.empty()) gPSP[PSP_IDX(psp_front, ineur, ircpt, ielmt) + iens] = val;
+        if (!gPSP_sp.empty()) gPSP_sp[PSP_IDX(psp_front, ineur, ircpt, ielmt) + iens] = static_cast<TFloat>(val);
+    };
+
+    //the parts of a step for one element (all the members of the ensemble), the rings are 
+    //positioned at psp_front and volt_rear:
+    //write the PSP of all the groups from the membrane potentials
+    void step_psp(const TInt& ielmt, const TInt& psp_front, const TInt& volt_rear);
+    //calculate the membrane potentials of all the groups from the input
+    void step_volt(const TInt& ielmt, const TInt& volt_rear);
+
+    //add mag times the PSP of the receptor rc to the membrane potential of a group from 
+    //the step eps after the one at volt_rear (tVolt_rear if omitted) on, see gKernel
+    void add2volt(const TInt& ielmt, const TInt& ineur, const Receptor& rc, const TInt& eps, const TReal& mag, 
+        const TInt& volt_rear);
+    inline void add2volt(const TInt& ielmt, const TInt& ineur, const Receptor& rc, const TInt& eps, const TReal& mag) {
+        add2volt(ielmt, ineur, rc, eps, mag, tVolt_rear);
+    };
+    //add2volt() of the PSP table psp[0 .. num-1] (KERNEL_TABLE)
+    inline void add2volt_table(const TInt& ielmt, const TInt& ineur, const TReal* psp, const TInt& num, 
+        const TInt& eps, const TReal& mag, const TInt& volt_rear);
 
     std::vector<TTimeWin> output_time;
 
@@ -78,12 +574,18 @@ public:
     //destructor
     ~Simulation(void);
 
-    //load parameter settings from a string
-    void load(std::map<std::string, std::string> &paramList);
+    //load parameter settings from a string. If model_only, only the model (LCM::init())
+    //is set up: no processes are started, the threads are left alone and nothing 
+    //of the run is allocated, so the Simulation can not be advanced (see lcmc.cpp)
+    void load(std::map<std::string, std::string> &paramList, const bool& model_only = false);
 
     //load parameter settings from a file 
     void load_from_file(const std::string& fname);
 
+    //load parameter settings from the text of a parameter file, fname is
+    //recorded as the file (a model compiled by lcmc), see load() for model_only
+    void load_from_text(const std::string& text, const std::string& fname, const bool& model_only = false);
+
     //initialise the simulation for running
     //this function is automatically called after the parameter is loaded
     //this function must be called after LCM paramter is changed
@@ -93,26 +595,91 @@ public:
     //time evolution: t <- t+dt
     void advance(void);
 
+    //advance the simulation up to max_step steps in one parallel region, the elements 
+    //are advanced through the steps independently (temporal blocking) if allowed. 
+    //The call ends at a step of which the data need to be output, see is_out(). 
+    //Return the number of steps advanced
+    TInt advance(const TInt& max_step);
+
+    //return the largest number of steps advanced by advance(const TInt&)
+    inline TInt block_step(void) const { return gBlock_step; };
+
     //return the step and time in simulation evolution 
     inline TInt  evlt_step(void) const { return tEvlt_step; };
     inline TReal evlt_time(void) const { return tEvlt_step*gStep_size; };
 
-    //return the voltage of a neuron group
+    //return the voltage of a neuron group, ielmt is the index on the grid
+    //and must be owned by the process, see get_volt()
     inline TReal Volt(const TInt& ielmt, const TInt& ineur) {
-        return gVolt[ielmt][ineur].rear();
+        return gVolt[VOLT_IDX(gSymm ? 0 : gGrid_col[ielmt], ineur, 0)];
     }
 
+    //set volt[ineur] to the voltages of the element ielmt (index on the grid) on the first
+    //process, which are sent by the process owning it. It is called by every process
+    void get_volt(const TInt& ielmt, std::vector<TReal>& volt);
+
+    //the number of processes of the run and the rank of this one, see SIMU.PROC_NUM
+    inline TInt proc_num() const { return gProc_num; };
+    inline TInt proc_rank() const { return gTrans ? gTrans->rank() : 0; };
+
+    //return the order the elements are stored in, see ElmtOrder
+    inline TInt elmt_order() const { return gElmt_order; };
+
+    //return the number of members of the ensemble, see SIMU.ENSEMBLE
+    inline TInt ens_num() const { return gEns_num; };
+
     //get the thread number specified by the user
     inline TInt thread_num() { return gThread_num; };
 
-    //get the header of the data file
-    void get_data_header(std::vector<char> &);
+    //the processor topology and whether the threads are pinned, see init_thread()
+    inline const Topology& topology() const { return gTopo; };
+    inline bool thread_pinned() const { return !gThread_cpu.empty(); };
+
+    //return how the PSP is added to the targets, see PspKernel
+    inline TInt psp_kernel() const { return gKernel; };
+
+    //return the precision of the gather, see Precision
+    inline TInt precision() const { return gPrecision; };
+
+    //return the largest deviation of the synaptic input (the amplitude of the PSP 
+    //added to a target) calculated in single precision from that in double precision, 
+    //and the largest input. The values are only recorded with PRECISION_VALIDATE
+    inline TReal prec_deviation() const { return gPrec_dev; };
+    inline TReal prec_magnitude() const { return gPrec_mag; };
+
+    //return the largest deviation of the membrane potential (mV) generated by the recursive 
+    //kernels from that of the time courses, only recorded with KERNEL_VALIDATE. The states
+    //are fed with the input of the run, so the deviation does not grow through the firing
+    inline TReal iir_deviation() const { 
+        return gIIR_dev.empty() ? 0. : *std::max_element(gIIR_dev.begin(), gIIR_dev.end()); 
+    };
+
+    //return the tolerance of the activity gating (0 if it is off), and the fraction of the 
+    //connection entries the gating has replaced by the mean PSP of their bucket
+    inline TReal gate_eps() const { return gGate_eps; };
+    inline TReal gate_skipped() const { return (gGate_num > 0.) ? gGate_skip / gGate_num : 0.; };
+
+    //return the radius of the far field (0 if it is off), and the largest deviation of its check at init
+    inline TReal far_radius() const { return gFar_radius; };
+    inline TReal far_deviation() const { return gFar_dev; };
+
+    //return whether the run is reduced to one column, see SIMU.SYMMETRY
+    inline bool symmetric() const { return gSymm; };
+
+    //return the engine, see SimuEngine, and the steps run with the push (ENGINE_PUSH and ENGINE_AUTO)
+    inline TInt engine() const { return gEngine; };
+    inline TInt push_steps() const { return gPush_steps; };
+
+    //get the header of the data file (of the member iens of the ensemble)
+    void get_data_header(std::vector<char> &, const TInt& iens = 0);
 
-    //get a data block contain the following info:
+    //get a data block contain the following info (called by every process, the
+    //block is only made on the first one):
     // curr_time + voltage for all neuronal groups in elements + a '\0'
     // the time and voltage info are with type of 'TFloat'
     // all data are re-formated to a array of unsigned char
-    void get_data_block(std::vector<char> &);
+    //iens is the member of the ensemble
+    void get_data_block(std::vector<char> &, const TInt& iens = 0);
 
     //get the parameter configuration
     inline std::string get_cfg() {
@@ -0,0 +1,245 @@
+//-------------------------------------------------
+//
+//          Laminar cortex model
+//
+// Developed by Jiaxin Du under the supervision of
+//    Prof. David Reutens and Dr. Viktor Vegh
+//
+//       Centre for Advanced Imaging (CAI),
+//   The University of Queensland (UQ), Australia
+//
+//        jiaxin.du@uqconnect.edu.au
+//
+// Reference:
+//  Du J, Vegh V, & Reutens DC,
+//                PLOS Compt Biol 8(10): e1002733.
+//              & NeuroImage 94: 1-11.
+//
+// See README for software copyright statements.
+//-------------------------------------------------
+#include "topology.h"
+#include "omp.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <sched.h>
+#include <dirent.h>
+#endif
+
+using namespace std;
+
+#ifdef __linux__
+
+//read the first integer of a file, return -1 if it fails
+static TInt read_int(const string& fname)
+{
+    ifstream fp(fname.c_str());
+    TInt val = -1;
+    if (!(fp >> val)) return -1;
+    return val;
+}
+
+//add the processors of a list like "0-3,8,10-11" to cpus
+static void read_cpulist(const string& fname, vector<TInt>& cpus)
+{
+    ifstream fp(fname.c_str());
+    string str;
+    if (!getline(fp, str)) return;
+
+    vector<string> parts, range;
+    strsplit(str, ",", parts);
+    for (vector<string>::iterator it = parts.begin(); it != parts.end(); ++it) {
+        TInt lo, hi;
+        strsplit(strtrim(*it), "-", range);
+        if (range.empty() || !str2int(strtrim(range[0]), lo)) continue;
+        hi = lo;
+        if (range.size() > 1 && !str2int(strtrim(range[1]), hi)) continue;
+        for (TInt cpu = lo; cpu <= hi; ++cpu) cpus.push_back(cpu);
+    }
+}
+
+//a processor, sorted by node, package, core and number
+struct TCpuInfo {
+    TInt node, pkg, core, cpu, rank;
+};
+
+static bool cpu_core_less(const TCpuInfo& a, const TCpuInfo& b)
+{
+    if (a.node != b.node) return a.node < b.node;
+    if (a.pkg != b.pkg) return a.pkg < b.pkg;
+    if (a.core != b.core) return a.core < b.core;
+    return a.cpu < b.cpu;
+}
+
+//the order of Topology::_cpu: the hyper-threads of a node after its physical cores
+static bool cpu_rank_less(const TCpuInfo& a, const TCpuInfo& b)
+{
+    if (a.node != b.node) return a.node < b.node;
+    if (a.rank != b.rank) return a.rank < b.rank;
+    return cpu_core_less(a, b);
+}
+
+#endif /* end of #ifdef __linux__ */
+
+Topology::Topology(void) : _node_num(1), _core_num(0), _sys_flg(false)
+{  }
+
+bool Topology::load(void)
+{
+    _cpu.clear();
+    _node.clear();
+    _rank.clear();
+    _node_num = 1;
+    _core_num = 0;
+    _sys_flg = false;
+
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+
+        //the nodes, numbered in the order of their ids (which may have gaps)
+        vector<TInt> node_id, cpu_node(CPU_SETSIZE, 0);
+        DIR *dir = opendir("/sys/devices/system/node");
+        if (dir != NULL) {
+            struct dirent *ent;
+            TInt id;
+            while ((ent = readdir(dir)) != NULL) {
+                string name(ent->d_name);
+                if (name.compare(0, 4, "node") == 0 && str2int(name.substr(4), id)) {
+                    node_id.push_back(id);
+                }
+            }
+            closedir(dir);
+        }
+        std::sort(node_id.begin(), node_id.end());
+
+        for (TInt inode = 0; inode < node_id.size(); ++inode) {
+            vector<TInt> cpus;
+            read_cpulist("/sys/devices/system/node/node" + int2str(node_id[inode]) + "/cpulist", cpus);
+            for (vector<TInt>::iterator it = cpus.begin(); it != cpus.end(); ++it) {
+                if (*it >= 0 && *it < CPU_SETSIZE) cpu_node[*it] = inode;
+            }
+        }
+
+        vector<TCpuInfo> info;
+        TCpuInfo tmp;
+        for (TInt cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &mask)) continue;
+
+            string path = "/sys/devices/system/cpu/cpu" + int2str(cpu) + "/topology/";
+            tmp.node = cpu_node[cpu];
+            tmp.pkg = read_int(path + "physical_package_id");
+            tmp.core = read_int(path + "core_id");
+            tmp.cpu = cpu;
+            tmp.rank = 0;
+            if (tmp.pkg < 0 || tmp.core < 0) { //every processor is a core
+                tmp.pkg = 0;
+                tmp.core = cpu;
+            }
+            info.push_back(tmp);
+        }
+
+        //the hyper-threads of a core follow each other
+        std::sort(info.begin(), info.end(), cpu_core_less);
+        for (TInt icpu = 1; icpu < info.size(); ++icpu) {
+            if (info[icpu].node == info[icpu - 1].node && info[icpu].pkg == info[icpu - 1].pkg
+                && info[icpu].core == info[icpu - 1].core) {
+                info[icpu].rank = info[icpu - 1].rank + 1;
+            }
+        }
+        std::sort(info.begin(), info.end(), cpu_rank_less);
+
+        for (vector<TCpuInfo>::iterator it = info.begin(); it != info.end(); ++it) {
+            if (!_node.empty() && it->node != _node.back()) ++_node_num;
+            _cpu.push_back(it->cpu);
+            _node.push_back(it->node);
+            _rank.push_back(it->rank);
+            if (it->rank == 0) ++_core_num;
+        }
+
+        _sys_flg = !_cpu.empty();
+    }
+#endif
+
+    if (!_sys_flg) {
+        _cpu.clear();
+        _node.clear();
+        _rank.clear();
+        _node_num = 1;
+        _core_num = omp_get_num_procs();
+        for (TInt cpu = 0; cpu < _core_num; ++cpu) {
+            _cpu.push_back(cpu);
+            _node.push_back(0);
+            _rank.push_back(0);
+        }
+    }
+
+    return _sys_flg;
+}
+
+TInt Topology::place(const TInt& nthrd, vector<TInt>& cpus) const
+{
+    assert(nthrd > 0 && nthrd <= cpu_num());
+
+    //the processors of a node are _cpu[node_bgn[inode]] .. _cpu[node_bgn[inode + 1] - 1]
+    vector<TInt> node_bgn(1, 0);
+    for (TInt icpu = 1; icpu < cpu_num(); ++icpu) {
+        if (_node[icpu] != _node[icpu - 1]) node_bgn.push_back(icpu);
+    }
+    node_bgn.push_back(cpu_num());
+
+    //the threads of a node, in proportion to its processors (largest remainder)
+    vector<TInt> num(_node_num);
+    vector<pair<TInt, TInt> > rem(_node_num); //(-remainder, node)
+    TInt rest = nthrd;
+    for (TInt inode = 0; inode < _node_num; ++inode) {
+        TInt cnt = node_bgn[inode + 1] - node_bgn[inode];
+        num[inode] = nthrd * cnt / cpu_num();
+        rem[inode] = make_pair(-(nthrd * cnt % cpu_num()), inode);
+        rest -= num[inode];
+    }
+    std::sort(rem.begin(), rem.end());
+    while (rest > 0) {
+        for (TInt idx = 0; idx < _node_num && rest > 0; ++idx) {
+            TInt inode = rem[idx].second;
+            if (num[inode] < node_bgn[inode + 1] - node_bgn[inode]) {
+                ++num[inode];
+                --rest;
+            }
+        }
+    }
+
+    //the physical cores of a node come first
+    TInt used = 0;
+    cpus.clear();
+    for (TInt inode = 0; inode < _node_num; ++inode) {
+        for (TInt ithrd = 0; ithrd < num[inode]; ++ithrd) {
+            cpus.push_back(_cpu[node_bgn[inode] + ithrd]);
+        }
+        if (num[inode] > 0) ++used;
+    }
+
+    return used;
+}
+
+bool Topology::pin(const TInt& cpu)
+{
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#else
+    return false;
+#endif
+}
+
+string Topology::print(void) const
+{
+    ostringstream oss;
+    oss << _node_num << " NUMA node" << (_node_num > 1 ? "s" : "") << ", "
+        << _core_num << " cores, " << cpu_num() << " processors";
+    if (!_sys_flg) oss << " (topology not available)";
+    return oss.str();
+}
@@ -0,0 +1,90 @@
+//-------------------------------------------------
+//
+//          Laminar cortex model
+//
+// Developed by Jiaxin Du under the supervision of
+//    Prof. David Reutens and Dr. Viktor Vegh
+//
+//       Centre for Advanced Imaging (CAI),
+//   The University of Queensland (UQ), Australia
+//
+//        jiaxin.du@uqconnect.edu.au
+//
+// Reference:
+//  Du J, Vegh V, & Reutens DC,
+//                PLOS Compt Biol 8(10): e1002733.
+//              & NeuroImage 94: 1-11.
+//
+// See README for software copyright statements.
+//-------------------------------------------------
+#pragma once
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+//----------------------------------------
+//          Processor topology
+//
+// Topology reads the NUMA nodes and the physical cores
+// of the processors the program may run on (the affinity
+// mask of the process) from /sys/devices/system, and
+// places the threads of a team on them:
+//   - the threads are shared between the nodes in
+//     proportion to their processors
+//   - the threads of a node take one processor of every
+//     physical core before the hyper-threads
+//   - the threads are numbered node by node, so a static
+//     loop over the elements gives every node a contiguous
+//     range of elements (and of their pages, see first touch
+//     in Simulation::init())
+//
+// Example:
+//   Topology topo;
+//   topo.load();
+//   std::vector<TInt> cpus;
+//   topo.place(nthrd, cpus);
+//   #pragma omp parallel
+//   Topology::pin(cpus[omp_get_thread_num()]);
+//
+// Other systems than Linux are taken as one node with
+// omp_get_num_procs() cores, which can not be pinned
+//----------------------------------------
+
+#include "misc.h"
+#include <vector>
+
+class Topology
+{
+private:
+    std::vector<TInt> _cpu;   //the processors, by node, then by hyper-thread rank, then by core
+    std::vector<TInt> _node;  //the node of _cpu[i]
+    std::vector<TInt> _rank;  //the hyper-thread rank of _cpu[i] in its core (0 for the first)
+    TInt              _node_num;
+    TInt              _core_num;
+    bool              _sys_flg; //whether the topology was read from /sys
+
+public:
+    Topology(void);
+
+    //read the topology, return false if /sys is not available
+    //(one node, every processor is a core)
+    bool load(void);
+
+    inline TInt node_num(void) const { return _node_num; };
+    inline TInt core_num(void) const { return _core_num; };
+    inline TInt cpu_num(void) const { return _cpu.size(); };
+
+    //whether the threads can be pinned
+    inline bool pinnable(void) const { return _sys_flg; };
+
+    //set cpus[ithrd] to the processor of the thread ithrd of a team of nthrd
+    //threads, nthrd must not exceed cpu_num(). Return the number of nodes used
+    TInt place(const TInt& nthrd, std::vector<TInt>& cpus) const;
+
+    //bind the calling thread to the processor cpu, return false if it fails
+    static bool pin(const TInt& cpu);
+
+    std::string print(void) const;
+};
+
+#endif /* end of #ifndef TOPOLOGY_H */
@@ -0,0 +1,242 @@
+//-------------------------------------------------
+//
+//          Laminar cortex model
+//
+// Developed by Jiaxin Du under the supervision of
+//    Prof. David Reutens and Dr. Viktor Vegh
+//
+//       Centre for Advanced Imaging (CAI),
+//   The University of Queensland (UQ), Australia
+//
+//        jiaxin.du@uqconnect.edu.au
+//
+// Reference:
+//  Du J, Vegh V, & Reutens DC,
+//                PLOS Compt Biol 8(10): e1002733.
+//              & NeuroImage 94: 1-11.
+//
+// See README for software copyright statements.
+//-------------------------------------------------
+#include "transport.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TRANSPORT_POSIX
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+using namespace std;
+
+SocketTransport::SocketTransport(void) : _rank(0), _size(1)
+{  }
+
+SocketTransport* SocketTransport::spawn(const TInt& nproc)
+{
+    assert(nproc > 0);
+
+#ifdef TRANSPORT_POSIX
+    //sock[a][b] is the end of the socket between a and b held by a
+    vector<vector<int> > sock(nproc, vector<int>(nproc, -1));
+    for (TInt a = 0; a < nproc; ++a) {
+        for (TInt b = a + 1; b < nproc; ++b) {
+            int sv[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+                cerr << "ERROR! SocketTransport::spawn: socketpair() failed (" << strerror(errno) << "). " << _FILE_LINE_ << endl;
+                for (TInt x = 0; x < nproc; ++x) {
+                    for (TInt y = 0; y < nproc; ++y) {
+                        if (sock[x][y] >= 0) close(sock[x][y]);
+                    }
+                }
+                return NULL;
+            }
+            sock[a][b] = sv[0];
+            sock[b][a] = sv[1];
+        }
+    }
+
+    //the buffered output would be written by every process
+    cout.flush();
+    cerr.flush();
+
+    SocketTransport *trans = new SocketTransport;
+    trans->_size = nproc;
+    trans->_rank = 0;
+
+    for (TInt iproc = 1; iproc < nproc; ++iproc) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            //the processes started see their sockets closed and end
+            cerr << "ERROR! SocketTransport::spawn: fork() failed (" << strerror(errno) << "). " << _FILE_LINE_ << endl;
+            for (TInt x = 0; x < nproc; ++x) {
+                for (TInt y = 0; y < nproc; ++y) {
+                    if (sock[x][y] >= 0) close(sock[x][y]);
+                }
+            }
+            delete trans;
+            return NULL;
+        }
+        if (pid == 0) {
+            trans->_rank = iproc;
+            trans->_pid.clear();
+            break;
+        }
+        trans->_pid.push_back(pid);
+    }
+
+    //keep the sockets of this process
+    trans->_fd.assign(nproc, -1);
+    for (TInt x = 0; x < nproc; ++x) {
+        for (TInt y = 0; y < nproc; ++y) {
+            if (sock[x][y] < 0) continue;
+            if (x == trans->_rank) {
+                trans->_fd[y] = sock[x][y];
+                fcntl(sock[x][y], F_SETFL, fcntl(sock[x][y], F_GETFL) | O_NONBLOCK);
+            }
+            else {
+                close(sock[x][y]);
+            }
+        }
+    }
+
+    return trans;
+#else
+    if (nproc > 1) {
+        cerr << "ERROR! SocketTransport::spawn: processes can not be started on this system. " << _FILE_LINE_ << endl;
+        return NULL;
+    }
+    return new SocketTransport;
+#endif
+}
+
+SocketTransport::~SocketTransport(void)
+{
+#ifdef TRANSPORT_POSIX
+    for (vector<int>::iterator it = _fd.begin(); it != _fd.end(); ++it) {
+        if (*it >= 0) close(*it);
+    }
+    for (vector<int>::iterator it = _pid.begin(); it != _pid.end(); ++it) {
+        int status;
+        waitpid(*it, &status, 0);
+    }
+#endif
+}
+
+//--------------------------------------------------
+// function bool SocketTransport::exchange(...)
+//   Every message is sent as its size (8 bytes) and its data. The
+//   sockets are non-blocking and served by poll(), so the processes
+//   do not wait for each other in a fixed order (the messages may be
+//   larger than the buffers of the sockets)
+//--------------------------------------------------
+bool SocketTransport::exchange(const vector<vector<char> >& send, vector<vector<char> >& recv)
+{
+    assert(send.size() == _size);
+
+    recv.resize(_size);
+    if (_size == 1) return true;
+
+#ifdef TRANSPORT_POSIX
+    vector<unsigned long long> send_len(_size), recv_len(_size, 0);
+    vector<size_t> send_off(_size, 0), recv_off(_size, 0); //bytes done, with the size
+    vector<bool> send_done(_size, false), recv_done(_size, false);
+    const size_t hdr = sizeof(unsigned long long);
+
+    TInt pending = 0;
+    for (TInt iproc = 0; iproc < _size; ++iproc) {
+        if (iproc == _rank) continue;
+        send_len[iproc] = send[iproc].size();
+        recv[iproc].clear();
+        pending += 2;
+    }
+
+    vector<struct pollfd> pfd;
+    vector<TInt> pfd_proc;
+    while (pending > 0) {
+        pfd.clear();
+        pfd_proc.clear();
+        for (TInt iproc = 0; iproc < _size; ++iproc) {
+            if (iproc == _rank || (send_done[iproc] && recv_done[iproc])) continue;
+            struct pollfd p;
+            p.fd = _fd[iproc];
+            p.events = (send_done[iproc] ? 0 : POLLOUT) | (recv_done[iproc] ? 0 : POLLIN);
+            p.revents = 0;
+            pfd.push_back(p);
+            pfd_proc.push_back(iproc);
+        }
+
+        if (poll(&pfd[0], pfd.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            cerr << "ERROR! SocketTransport::exchange: poll() failed (" << strerror(errno) << "). " << _FILE_LINE_ << endl;
+            return false;
+        }
+
+        for (TInt ipfd = 0; ipfd < pfd.size(); ++ipfd) {
+            TInt iproc = pfd_proc[ipfd];
+            int fd = pfd[ipfd].fd;
+
+            if ((pfd[ipfd].revents & POLLOUT) && !send_done[iproc]) {
+                const char *buf;
+                size_t len;
+                if (send_off[iproc] < hdr) {
+                    buf = reinterpret_cast<const char*>(&send_len[iproc]) + send_off[iproc];
+                    len = hdr - send_off[iproc];
+                }
+                else {
+                    buf = send[iproc].data() + (send_off[iproc] - hdr);
+                    len = hdr + send_len[iproc] - send_off[iproc];
+                }
+                ssize_t n = ::send(fd, buf, len, MSG_NOSIGNAL);
+                if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    cerr << "ERROR! SocketTransport::exchange: process " << iproc << " can not be reached ("
+                        << strerror(errno) << "). " << _FILE_LINE_ << endl;
+                    return false;
+                }
+                if (n > 0) send_off[iproc] += n;
+                if (send_off[iproc] == hdr + send_len[iproc]) {
+                    send_done[iproc] = true;
+                    --pending;
+                }
+            }
+
+            if ((pfd[ipfd].revents & (POLLIN | POLLHUP | POLLERR)) && !recv_done[iproc]) {
+                char *buf;
+                size_t len;
+                if (recv_off[iproc] < hdr) {
+                    buf = reinterpret_cast<char*>(&recv_len[iproc]) + recv_off[iproc];
+                    len = hdr - recv_off[iproc];
+                }
+                else {
+                    buf = recv[iproc].data() + (recv_off[iproc] - hdr);
+                    len = hdr + recv_len[iproc] - recv_off[iproc];
+                }
+                ssize_t n = ::recv(fd, buf, len, 0);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    cerr << "ERROR! SocketTransport::exchange: process " << iproc << " has ended. " << _FILE_LINE_ << endl;
+                    return false;
+                }
+                if (n > 0) {
+                    recv_off[iproc] += n;
+                    if (recv_off[iproc] == hdr) recv[iproc].resize(recv_len[iproc]);
+                }
+                if (recv_off[iproc] >= hdr && recv_off[iproc] == hdr + recv_len[iproc]) {
+                    recv_done[iproc] = true;
+                    --pending;
+                }
+            }
+        }
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,97 @@
+//-------------------------------------------------
+//
+//          Laminar cortex model
+//
+// Developed by Jiaxin Du under the supervision of
+//    Prof. David Reutens and Dr. Viktor Vegh
+//
+//       Centre for Advanced Imaging (CAI),
+//   The University of Queensland (UQ), Australia
+//
+//        jiaxin.du@uqconnect.edu.au
+//
+// Reference:
+//  Du J, Vegh V, & Reutens DC,
+//                PLOS Compt Biol 8(10): e1002733.
+//              & NeuroImage 94: 1-11.
+//
+// See README for software copyright statements.
+//-------------------------------------------------
+#pragma once
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+//----------------------------------------
+//     Message transport between processes
+//
+// Transport connects the processes of a distributed
+// run (see SIMU.PROC_NUM), which are numbered 0 ..
+// size()-1. All the communication is done by exchange(),
+// which every process calls at the same point:
+//   send[p] is sent to the process p, and recv[p] is
+//   resized to and filled with the message of the process
+//   p to this one (send[rank()] and recv[rank()] are not
+//   used, an empty message is sent as well)
+//
+// SocketTransport is the backend for one machine: the
+// processes are forked from the first one and connected
+// by pairs of Unix domain sockets. Other backends (e.g.,
+// MPI) only need to implement the interface
+//
+// Example:
+//   Transport *trans = SocketTransport::spawn(4);
+//   std::vector<std::vector<char> > send(4), recv;
+//   ... fill send[p] for p != trans->rank()
+//   trans->exchange(send, recv);
+//   delete trans; //the first process waits for the others
+//----------------------------------------
+
+#include "misc.h"
+#include <vector>
+
+class Transport
+{
+public:
+    virtual ~Transport(void) {  };
+
+    virtual TInt rank(void) const = 0;
+    virtual TInt size(void) const = 0;
+
+    //send send[p] to every other process p, and receive recv[p] from it.
+    //return false if a process can not be reached
+    virtual bool exchange(const std::vector<std::vector<char> >& send, std::vector<std::vector<char> >& recv) = 0;
+
+    //the name of the backend
+    virtual std::string name(void) const = 0;
+};
+
+class SocketTransport : public Transport
+{
+private:
+    TInt              _rank;
+    TInt              _size;
+    std::vector<int>  _fd;    //[proc], socket to a process, -1 for this one
+    std::vector<int>  _pid;   //[proc], the processes started by the first one (rank 0 only)
+
+    SocketTransport(void);
+
+public:
+    //fork nproc - 1 processes from the calling one, connected to each other,
+    //and return the transport of the calling process (rank 0) or of the new
+    //ones. Return NULL if the processes can not be started. It must be called
+    //before any OpenMP parallel region (the threads are not forked)
+    static SocketTransport* spawn(const TInt& nproc);
+
+    //close the sockets, the first process waits for the others to end
+    ~SocketTransport(void);
+
+    inline TInt rank(void) const { return _rank; };
+    inline TInt size(void) const { return _size; };
+
+    bool exchange(const std::vector<std::vector<char> >& send, std::vector<std::vector<char> >& recv);
+
+    inline std::string name(void) const { return "Unix sockets"; };
+};
+
+#endif /* end of #ifndef TRANSPORT_H */